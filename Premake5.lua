@@ -27,5 +27,83 @@ project "Eos"
 		"Source/**.cpp", "Source/**.hpp",
 		"Source/**.hlsl", "Source/**.hlsli",
 	}
+	removefiles { "Source/BenchmarkStart.cpp", "Source/CookerStart.cpp", "Source/HeadlessStart.cpp" }
+
+	filter {}
+
+project "EosHeadless"
+	kind "ConsoleApp"
+
+	includedirs { "Source", "Luft/Source" }
+	links { "Luft" }
+
+	SetConfigurationSettings()
+	UseWindowsSettings()
+
+	files {
+		"Source/ArenaAllocator.cpp", "Source/ArenaAllocator.hpp",
+		"Source/BVH.cpp", "Source/BVH.hpp",
+		"Source/CameraController.cpp", "Source/CameraController.hpp",
+		"Source/CommandLine.cpp", "Source/CommandLine.hpp",
+		"Source/CpuRaytracer.cpp", "Source/CpuRaytracer.hpp",
+		"Source/Decimal.cpp", "Source/Decimal.hpp",
+		"Source/File.cpp", "Source/File.hpp",
+		"Source/HeadlessStart.cpp",
+		"Source/Image.cpp", "Source/Image.hpp",
+		"Source/JSON.cpp", "Source/JSON.hpp",
+		"Source/Log.hpp",
+		"Source/Scene.cpp", "Source/Scene.hpp",
+		"Source/SphereSoa.cpp", "Source/SphereSoa.hpp",
+		"Source/ThreadPool.cpp", "Source/ThreadPool.hpp",
+		"Source/TileScheduler.cpp", "Source/TileScheduler.hpp",
+		"Source/Trace.hpp",
+	}
+
+	filter {}
+
+project "EosBenchmark"
+	kind "ConsoleApp"
+
+	includedirs { "Source", "Luft/Source" }
+	links { "Luft" }
+
+	SetConfigurationSettings()
+	UseWindowsSettings()
+
+	files {
+		"Source/ArenaAllocator.cpp", "Source/ArenaAllocator.hpp",
+		"Source/BenchmarkStart.cpp",
+		"Source/CommandLine.cpp", "Source/CommandLine.hpp",
+		"Source/Decimal.cpp", "Source/Decimal.hpp",
+		"Source/File.cpp", "Source/File.hpp",
+		"Source/GlyphTable.cpp", "Source/GlyphTable.hpp",
+		"Source/JSON.cpp", "Source/JSON.hpp",
+		"Source/Log.hpp",
+		"Source/ThreadPool.cpp", "Source/ThreadPool.hpp",
+	}
+
+	filter {}
+
+project "EosCooker"
+	kind "ConsoleApp"
+
+	-- Only for the texture formats, nothing here creates a device.
+	includedirs { "Source", "Luft/Source", "RHI/Source", "RHI/ThirdParty" }
+	links { "Luft", "RHI" }
+
+	SetConfigurationSettings()
+	UseWindowsSettings()
+
+	files {
+		"Source/BC7.cpp", "Source/BC7.hpp",
+		"Source/CommandLine.cpp", "Source/CommandLine.hpp",
+		"Source/CookerStart.cpp",
+		"Source/DDS.cpp", "Source/DDS.hpp",
+		"Source/File.cpp", "Source/File.hpp",
+		"Source/Image.cpp", "Source/Image.hpp",
+		"Source/Log.hpp",
+		"Source/MipMaps.cpp", "Source/MipMaps.hpp",
+		"Source/ThreadPool.cpp", "Source/ThreadPool.hpp",
+	}
 
 	filter {}
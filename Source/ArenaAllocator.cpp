@@ -0,0 +1,106 @@
+#include "ArenaAllocator.hpp"
+
+#include "Luft/Math.hpp"
+
+static constexpr usize ArenaAlignment = 16;
+
+static usize AlignUp(usize size, usize alignment)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static constexpr usize BlockHeaderSize = (sizeof(void*) + sizeof(usize) + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+
+ArenaAllocator::ArenaAllocator(usize blockSize, Allocator* parent)
+	: Parent(parent)
+	, BlockSize(blockSize)
+	, Current(nullptr)
+	, Offset(0)
+	, LastAllocationOffset(0)
+	, UsedSize(0)
+	, ReservedSize(0)
+{
+	CHECK(parent);
+	CHECK(blockSize > BlockHeaderSize);
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+	while (Current)
+	{
+		Block* previous = Current->Previous;
+		Parent->Deallocate(Current, Current->Size);
+		Current = previous;
+	}
+}
+
+uint8* ArenaAllocator::GetBlockData(Block* block)
+{
+	return reinterpret_cast<uint8*>(block) + BlockHeaderSize;
+}
+
+void ArenaAllocator::AddBlock(usize minimumSize)
+{
+	const usize size = Max(BlockSize, BlockHeaderSize + minimumSize);
+
+	Block* block = static_cast<Block*>(Parent->Allocate(size));
+	block->Previous = Current;
+	block->Size = size;
+
+	Current = block;
+	Offset = 0;
+	LastAllocationOffset = 0;
+	ReservedSize += size;
+}
+
+void* ArenaAllocator::Allocate(usize size)
+{
+	const usize alignedSize = AlignUp(Max(size, usize { 1 }), ArenaAlignment);
+	if (!Current || Offset + alignedSize > Current->Size - BlockHeaderSize)
+	{
+		AddBlock(alignedSize);
+	}
+
+	void* data = GetBlockData(Current) + Offset;
+	LastAllocationOffset = Offset;
+	Offset += alignedSize;
+	UsedSize += alignedSize;
+	return data;
+}
+
+void ArenaAllocator::Deallocate(const void* data, usize size)
+{
+	if (!data || !Current)
+	{
+		return;
+	}
+
+	const usize alignedSize = AlignUp(Max(size, usize { 1 }), ArenaAlignment);
+	if (data == GetBlockData(Current) + LastAllocationOffset && LastAllocationOffset + alignedSize == Offset)
+	{
+		Offset = LastAllocationOffset;
+		UsedSize -= alignedSize;
+	}
+}
+
+void ArenaAllocator::Reset()
+{
+	if (!Current)
+	{
+		return;
+	}
+
+	Block* previous = Current->Previous;
+	while (previous)
+	{
+		Block* next = previous->Previous;
+		ReservedSize -= previous->Size;
+		Parent->Deallocate(previous, previous->Size);
+		previous = next;
+	}
+
+	Current->Previous = nullptr;
+	Offset = 0;
+	LastAllocationOffset = 0;
+	UsedSize = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Luft/Base.hpp"
+#include "Luft/NoCopy.hpp"
+
+// Bump allocator that carves allocations out of large blocks and releases them all at once, on Reset or destruction.
+// Deallocate only gives memory back when it is the most recent allocation, anything else waits for the reset.
+class ArenaAllocator final : public Allocator, public NoCopy
+{
+public:
+	static constexpr usize DefaultBlockSize = 64 * 1024;
+
+	explicit ArenaAllocator(usize blockSize = DefaultBlockSize, Allocator* parent = &GlobalAllocator::Get());
+	~ArenaAllocator();
+
+	void* Allocate(usize size) override;
+	void Deallocate(const void* data, usize size) override;
+
+	// Keeps the most recent block for reuse and returns the rest to the parent allocator.
+	void Reset();
+
+	usize GetUsedSize() const { return UsedSize; }
+	usize GetReservedSize() const { return ReservedSize; }
+
+private:
+	struct Block
+	{
+		Block* Previous;
+		usize Size;
+	};
+
+	static uint8* GetBlockData(Block* block);
+
+	void AddBlock(usize minimumSize);
+
+	Allocator* Parent;
+	usize BlockSize;
+
+	Block* Current;
+	usize Offset;
+	usize LastAllocationOffset;
+
+	usize UsedSize;
+	usize ReservedSize;
+};
@@ -0,0 +1,1110 @@
+#include "BC7.hpp"
+#include "DDS.hpp"
+#include "ThreadPool.hpp"
+
+#include "Luft/Math.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+struct Bc7Mode
+{
+	uint32 SubsetCount;
+	uint32 PartitionBits;
+	uint32 RotationBits;
+	uint32 IndexSelectionBits;
+	uint32 ColorBits;
+	uint32 AlphaBits;
+	bool EndpointPBits;
+	bool SharedPBits;
+	uint32 IndexBits;
+	uint32 SecondaryIndexBits;
+};
+
+static constexpr Bc7Mode Modes[8] =
+{
+	{ 3, 4, 0, 0, 4, 0, true, false, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, false, true, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, false, false, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, true, false, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, false, false, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, false, false, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, true, false, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, true, false, 2, 0 },
+};
+
+// The subset of every pixel in row order, a bit per pixel for two subsets and two bits per pixel for three.
+static constexpr uint16 Partitions2[64] =
+{
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+	0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+	0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+	0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+	0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+static constexpr uint32 Partitions3[64] =
+{
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+// Pixel 0 anchors the first subset, these the others. An anchor's index is stored without its top bit, which must be zero.
+static constexpr uint8 Anchors2[64] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+static constexpr uint8 Anchors3Second[64] =
+{
+	 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+	 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+	 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+	 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+};
+
+static constexpr uint8 Anchors3Third[64] =
+{
+	15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+	15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+	15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+	15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+};
+
+static constexpr uint8 Weights2[4] = { 0, 21, 43, 64 };
+static constexpr uint8 Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static constexpr uint8 Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const uint8* GetWeights(uint32 indexBits)
+{
+	return (indexBits == 2) ? Weights2 : (indexBits == 3) ? Weights3 : Weights4;
+}
+
+static uint32 GetSubset(uint32 subsetCount, uint32 partition, uint32 pixel)
+{
+	if (subsetCount == 2)
+	{
+		return (Partitions2[partition] >> pixel) & 1;
+	}
+	if (subsetCount == 3)
+	{
+		return (Partitions3[partition] >> (2 * pixel)) & 3;
+	}
+	return 0;
+}
+
+static uint32 GetAnchor(uint32 subsetCount, uint32 partition, uint32 subset)
+{
+	if (subset == 0)
+	{
+		return 0;
+	}
+	if (subsetCount == 2)
+	{
+		return Anchors2[partition];
+	}
+	return (subset == 1) ? Anchors3Second[partition] : Anchors3Third[partition];
+}
+
+static bool IsAnchor(uint32 subsetCount, uint32 partition, uint32 pixel)
+{
+	const uint32 subset = GetSubset(subsetCount, partition, pixel);
+	return pixel == GetAnchor(subsetCount, partition, subset);
+}
+
+// Widens an endpoint to eight bits by repeating its top bits below it.
+static uint32 Unquantize(uint32 value, uint32 bits)
+{
+	value <<= 8 - bits;
+	return value | (value >> bits);
+}
+
+static uint8 Interpolate(uint32 low, uint32 high, uint32 weight)
+{
+	return static_cast<uint8>(((64 - weight) * low + weight * high + 32) >> 6);
+}
+
+struct BlockReader
+{
+	uint64 Low;
+	uint64 High;
+	uint32 Position;
+
+	uint32 Read(uint32 count)
+	{
+		uint64 bits;
+		if (Position >= 64)
+		{
+			bits = High >> (Position - 64);
+		}
+		else if (Position + count <= 64)
+		{
+			bits = Low >> Position;
+		}
+		else
+		{
+			bits = (Low >> Position) | (High << (64 - Position));
+		}
+		Position += count;
+		return static_cast<uint32>(bits & ((uint64 { 1 } << count) - 1));
+	}
+};
+
+// Blends every channel of every pixel between its subset's endpoints. The weights are per channel so that modes with
+// separate alpha indices take the same path as the rest.
+static void InterpolateBlock(const uint8* low, const uint8* high, const uint16* weights, uint8* rgba)
+{
+#if defined(__AVX2__)
+	const __m256i sixtyFour = _mm256_set1_epi16(64);
+	const __m256i rounding = _mm256_set1_epi16(32);
+
+	__m256i channels[4];
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		const __m256i lowChannels = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low + 16 * i)));
+		const __m256i highChannels = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high + 16 * i)));
+		const __m256i weight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + 16 * i));
+
+		const __m256i lowTerm = _mm256_mullo_epi16(lowChannels, _mm256_sub_epi16(sixtyFour, weight));
+		const __m256i highTerm = _mm256_mullo_epi16(highChannels, weight);
+		channels[i] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lowTerm, highTerm), rounding), 6);
+	}
+
+	// Packing works within 128-bit lanes, the permute puts the pixels back in order.
+	const __m256i first = _mm256_permute4x64_epi64(_mm256_packus_epi16(channels[0], channels[1]), 0xD8);
+	const __m256i second = _mm256_permute4x64_epi64(_mm256_packus_epi16(channels[2], channels[3]), 0xD8);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba), first);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + 32), second);
+#else
+	for (uint32 i = 0; i < 64; ++i)
+	{
+		rgba[i] = Interpolate(low[i], high[i], weights[i]);
+	}
+#endif
+}
+
+void DecodeBc7Block(const uint8* block, uint8* rgba)
+{
+	CHECK(block);
+	CHECK(rgba);
+
+	BlockReader reader = {};
+	memcpy(&reader.Low, block, sizeof(uint64));
+	memcpy(&reader.High, block + sizeof(uint64), sizeof(uint64));
+
+	// The mode is the number of zeros before the first set bit.
+	uint32 modeIndex = 0;
+	while (modeIndex < 8 && reader.Read(1) == 0)
+	{
+		++modeIndex;
+	}
+	if (modeIndex == 8)
+	{
+		memset(rgba, 0, 64);
+		return;
+	}
+
+	const Bc7Mode& mode = Modes[modeIndex];
+	const uint32 partition = reader.Read(mode.PartitionBits);
+	const uint32 rotation = reader.Read(mode.RotationBits);
+	const uint32 indexSelection = reader.Read(mode.IndexSelectionBits);
+
+	// Stored a channel at a time: red for both endpoints of every subset, then green, blue and alpha.
+	const uint32 endpointCount = mode.SubsetCount * 2;
+	uint32 endpoints[6][4];
+	for (uint32 channel = 0; channel < 3; ++channel)
+	{
+		for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+		{
+			endpoints[endpoint][channel] = reader.Read(mode.ColorBits);
+		}
+	}
+	for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+	{
+		endpoints[endpoint][3] = (mode.AlphaBits != 0) ? reader.Read(mode.AlphaBits) : 255;
+	}
+
+	const uint32 channelCount = (mode.AlphaBits != 0) ? 4 : 3;
+	const uint32 pBitCount = (mode.EndpointPBits || mode.SharedPBits) ? 1 : 0;
+	if (pBitCount != 0)
+	{
+		uint32 pBits[6];
+		for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+		{
+			const bool isShared = mode.SharedPBits && (endpoint % 2) == 1;
+			pBits[endpoint] = isShared ? pBits[endpoint - 1] : reader.Read(1);
+		}
+		for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+		{
+			for (uint32 channel = 0; channel < channelCount; ++channel)
+			{
+				endpoints[endpoint][channel] = (endpoints[endpoint][channel] << 1) | pBits[endpoint];
+			}
+		}
+	}
+
+	uint8 low[64];
+	uint8 high[64];
+	for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+	{
+		for (uint32 channel = 0; channel < 3; ++channel)
+		{
+			endpoints[endpoint][channel] = Unquantize(endpoints[endpoint][channel], mode.ColorBits + pBitCount);
+		}
+		if (mode.AlphaBits != 0)
+		{
+			endpoints[endpoint][3] = Unquantize(endpoints[endpoint][3], mode.AlphaBits + pBitCount);
+		}
+	}
+
+	uint32 indices[16];
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		const bool isAnchor = IsAnchor(mode.SubsetCount, partition, pixel);
+		indices[pixel] = reader.Read(mode.IndexBits - (isAnchor ? 1 : 0));
+	}
+
+	// Modes 4 and 5 give alpha indices of its own, and in mode 4 the index selection bit swaps which set is which.
+	uint32 secondaryIndices[16];
+	const uint32* colorIndices = indices;
+	const uint32* alphaIndices = indices;
+	uint32 colorIndexBits = mode.IndexBits;
+	uint32 alphaIndexBits = mode.IndexBits;
+	if (mode.SecondaryIndexBits != 0)
+	{
+		for (uint32 pixel = 0; pixel < 16; ++pixel)
+		{
+			secondaryIndices[pixel] = reader.Read(mode.SecondaryIndexBits - (pixel == 0 ? 1 : 0));
+		}
+		alphaIndices = secondaryIndices;
+		alphaIndexBits = mode.SecondaryIndexBits;
+		if (indexSelection != 0)
+		{
+			colorIndices = secondaryIndices;
+			alphaIndices = indices;
+			colorIndexBits = mode.SecondaryIndexBits;
+			alphaIndexBits = mode.IndexBits;
+		}
+	}
+	CHECK(reader.Position == 128);
+
+	const uint8* colorWeights = GetWeights(colorIndexBits);
+	const uint8* alphaWeights = GetWeights(alphaIndexBits);
+
+	alignas(32) uint16 weights[64];
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		const uint32 subset = GetSubset(mode.SubsetCount, partition, pixel);
+		for (uint32 channel = 0; channel < 4; ++channel)
+		{
+			low[pixel * 4 + channel] = static_cast<uint8>(endpoints[subset * 2][channel]);
+			high[pixel * 4 + channel] = static_cast<uint8>(endpoints[subset * 2 + 1][channel]);
+		}
+
+		const uint16 colorWeight = colorWeights[colorIndices[pixel]];
+		weights[pixel * 4 + 0] = colorWeight;
+		weights[pixel * 4 + 1] = colorWeight;
+		weights[pixel * 4 + 2] = colorWeight;
+		weights[pixel * 4 + 3] = alphaWeights[alphaIndices[pixel]];
+	}
+
+	InterpolateBlock(low, high, weights, rgba);
+
+	// Rotation swaps alpha with one of the color channels, so that channel gets the separate indices instead.
+	if (rotation != 0)
+	{
+		for (uint32 pixel = 0; pixel < 16; ++pixel)
+		{
+			uint8* color = rgba + pixel * 4;
+			const uint8 alpha = color[3];
+			color[3] = color[rotation - 1];
+			color[rotation - 1] = alpha;
+		}
+	}
+}
+
+void DecodeBc7(const uint8* blocks, usize rowPitch, uint32 width, uint32 height, uint8* rgba)
+{
+	CHECK(blocks);
+	CHECK(rgba);
+
+	uint8 block[64];
+	for (uint32 blockY = 0; blockY < height; blockY += Bc7BlockDimension)
+	{
+		const uint8* blockRow = blocks + (blockY / Bc7BlockDimension) * rowPitch;
+		for (uint32 blockX = 0; blockX < width; blockX += Bc7BlockDimension)
+		{
+			DecodeBc7Block(blockRow + (blockX / Bc7BlockDimension) * Bc7BlockSize, block);
+
+			const uint32 rowCount = Min(height - blockY, Bc7BlockDimension);
+			const uint32 columnCount = Min(width - blockX, Bc7BlockDimension);
+			for (uint32 y = 0; y < rowCount; ++y)
+			{
+				memcpy(rgba + ((blockY + y) * static_cast<usize>(width) + blockX) * 4, block + y * 16, columnCount * 4);
+			}
+		}
+	}
+}
+
+void DecodeDdsSubresource(const DdsImage& image, uint32 mipMap, uint32 arrayLayer, uint8* rgba)
+{
+	const DdsSubresource& subresource = image.GetSubresource(mipMap, arrayLayer);
+	const uint8* data = image.Data + subresource.Offset;
+
+	switch (image.Format)
+	{
+	case TextureFormat::Bc7Unorm:
+	case TextureFormat::Bc7SrgbUnorm:
+		DecodeBc7(data, subresource.RowPitch, subresource.Width, subresource.Height, rgba);
+		break;
+	case TextureFormat::Rgba8Unorm:
+	case TextureFormat::Rgba8SrgbUnorm:
+		for (uint32 y = 0; y < subresource.Height; ++y)
+		{
+			memcpy(rgba + y * static_cast<usize>(subresource.Width) * 4, data + y * subresource.RowPitch, subresource.Width * 4);
+		}
+		break;
+	default:
+		VERIFY(false, "Unsupported DDS format for decoding!");
+		break;
+	}
+}
+
+struct BlockWriter
+{
+	uint64 Low;
+	uint64 High;
+	uint32 Position;
+
+	void Write(uint32 value, uint32 count)
+	{
+		const uint64 bits = value;
+		if (Position >= 64)
+		{
+			High |= bits << (Position - 64);
+		}
+		else
+		{
+			Low |= bits << Position;
+			if (Position + count > 64)
+			{
+				High |= bits >> (64 - Position);
+			}
+		}
+		Position += count;
+	}
+};
+
+struct EncoderSettings
+{
+	uint32 ModeMask;
+	uint32 PartitionCandidates;
+	uint32 Iterations;
+	bool AllRotations;
+};
+
+static constexpr EncoderSettings QualitySettings[] =
+{
+	{ 1 << 6, 0, 1, false },
+	{ (1 << 1) | (1 << 3) | (1 << 5) | (1 << 6) | (1 << 7), 4, 2, false },
+	{ 0xFF, 16, 4, true },
+};
+
+enum class PBitMode
+{
+	None,
+	Unique,
+	Shared,
+};
+
+// What to fit to the pixels of one subset: which channels, at what precision and with how many index bits.
+struct FitParameters
+{
+	uint32 FirstChannel;
+	uint32 ChannelCount;
+	uint32 EndpointBits;
+	PBitMode PBits;
+	uint32 IndexBits;
+	uint32 Iterations;
+};
+
+struct SubsetFit
+{
+	// Quantized, without the p-bits.
+	uint32 Endpoints[2][4];
+	uint32 PBits[2];
+
+	// In the order of the subset's pixels.
+	uint8 Indices[16];
+	uint32 Error;
+};
+
+struct EncodedBlock
+{
+	uint64 Low;
+	uint64 High;
+	uint32 Error;
+};
+
+// The code that widens closest to every eight bit value, by endpoint precision and p-bit: none, zero or one.
+struct QuantizationTable
+{
+	uint8 Codes[9][3][256];
+
+	QuantizationTable()
+		: Codes()
+	{
+		for (uint32 bits = 4; bits <= 8; ++bits)
+		{
+			for (uint32 variant = 0; variant < 3; ++variant)
+			{
+				const bool hasPBit = variant != 0;
+				const uint32 totalBits = bits + (hasPBit ? 1 : 0);
+				if (totalBits > 8)
+				{
+					continue;
+				}
+
+				for (uint32 value = 0; value < 256; ++value)
+				{
+					uint32 bestDistance = ~0u;
+					for (uint32 code = 0; code < (1u << bits); ++code)
+					{
+						const uint32 widened = Unquantize(hasPBit ? ((code << 1) | (variant - 1)) : code, totalBits);
+						const uint32 distance = static_cast<uint32>(Absolute(static_cast<int32>(widened) - static_cast<int32>(value)));
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							Codes[bits][variant][value] = static_cast<uint8>(code);
+						}
+					}
+				}
+			}
+		}
+	}
+};
+
+static const QuantizationTable Quantization;
+
+static uint32 QuantizeChannel(float value, uint32 bits, bool hasPBit, uint32 pBit)
+{
+	const uint32 variant = hasPBit ? 1 + pBit : 0;
+	return Quantization.Codes[bits][variant][static_cast<uint32>(value + 0.5f)];
+}
+
+// Picks the nearest palette entry for every pixel. Returns the squared error over the fitted channels.
+static uint32 AssignIndices(const uint8 (*pixels)[4], const uint8* members, uint32 memberCount, const FitParameters& parameters,
+							const uint32 (*endpoints)[4], uint8* indices)
+{
+	const uint32 firstChannel = parameters.FirstChannel;
+	const uint32 lastChannel = parameters.FirstChannel + parameters.ChannelCount;
+	const uint8* weights = GetWeights(parameters.IndexBits);
+	const int32 lastEntry = (1 << parameters.IndexBits) - 1;
+
+	uint8 palette[16][4];
+	int32 direction[4] = {};
+	int32 lengthSquared = 0;
+	for (uint32 channel = firstChannel; channel < lastChannel; ++channel)
+	{
+		for (int32 entry = 0; entry <= lastEntry; ++entry)
+		{
+			palette[entry][channel] = Interpolate(endpoints[0][channel], endpoints[1][channel], weights[entry]);
+		}
+		direction[channel] = static_cast<int32>(endpoints[1][channel]) - static_cast<int32>(endpoints[0][channel]);
+		lengthSquared += direction[channel] * direction[channel];
+	}
+	const float scale = (lengthSquared != 0) ? static_cast<float>(lastEntry) / static_cast<float>(lengthSquared) : 0.0f;
+
+	uint32 error = 0;
+	for (uint32 member = 0; member < memberCount; ++member)
+	{
+		const uint8* pixel = pixels[members[member]];
+
+		// The palette lies along the line between the endpoints, so only the entries either side of the pixel's
+		// projection onto it can be nearest. The weights are not quite evenly spaced, hence a neighbour on each side.
+		int32 projection = 0;
+		for (uint32 channel = firstChannel; channel < lastChannel; ++channel)
+		{
+			projection += (static_cast<int32>(pixel[channel]) - static_cast<int32>(endpoints[0][channel])) * direction[channel];
+		}
+		const int32 nearest = Min(Max(static_cast<int32>(static_cast<float>(projection) * scale + 0.5f), 0), lastEntry);
+
+		uint32 bestError = ~0u;
+		int32 bestEntry = 0;
+		for (int32 entry = Max(nearest - 1, 0); entry <= Min(nearest + 1, lastEntry); ++entry)
+		{
+			uint32 entryError = 0;
+			for (uint32 channel = firstChannel; channel < lastChannel; ++channel)
+			{
+				const int32 difference = static_cast<int32>(pixel[channel]) - static_cast<int32>(palette[entry][channel]);
+				entryError += static_cast<uint32>(difference * difference);
+			}
+			if (entryError < bestError)
+			{
+				bestError = entryError;
+				bestEntry = entry;
+			}
+		}
+		indices[member] = static_cast<uint8>(bestEntry);
+		error += bestError;
+	}
+	return error;
+}
+
+// The direction the pixels spread along most, by power iteration on their covariance. Returns the mean as well.
+static void GetPrincipalAxis(const uint8 (*pixels)[4], const uint8* members, uint32 memberCount, uint32 firstChannel, uint32 channelCount,
+							 float* mean, float* axis)
+{
+	for (uint32 channel = 0; channel < 4; ++channel)
+	{
+		mean[channel] = 0.0f;
+		axis[channel] = 0.0f;
+	}
+	for (uint32 member = 0; member < memberCount; ++member)
+	{
+		for (uint32 channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+		{
+			mean[channel] += pixels[members[member]][channel];
+		}
+	}
+	for (uint32 channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+	{
+		mean[channel] /= static_cast<float>(memberCount);
+	}
+
+	float covariance[4][4] = {};
+	for (uint32 member = 0; member < memberCount; ++member)
+	{
+		for (uint32 row = firstChannel; row < firstChannel + channelCount; ++row)
+		{
+			const float rowOffset = pixels[members[member]][row] - mean[row];
+			for (uint32 column = firstChannel; column < firstChannel + channelCount; ++column)
+			{
+				covariance[row][column] += rowOffset * (pixels[members[member]][column] - mean[column]);
+			}
+		}
+	}
+
+	for (uint32 channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+	{
+		axis[channel] = 1.0f;
+	}
+
+	for (uint32 iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		float length = 0.0f;
+		for (uint32 row = firstChannel; row < firstChannel + channelCount; ++row)
+		{
+			for (uint32 column = firstChannel; column < firstChannel + channelCount; ++column)
+			{
+				next[row] += covariance[row][column] * axis[column];
+			}
+			length += next[row] * next[row];
+		}
+		if (length < 1.0e-12f)
+		{
+			break;
+		}
+
+		const float inverseLength = 1.0f / sqrtf(length);
+		for (uint32 channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+		{
+			axis[channel] = next[channel] * inverseLength;
+		}
+	}
+}
+
+// How much of the subsets' spread a line through each of them leaves unexplained, a cheap stand-in for the error of
+// actually encoding the partition. That is the covariance's trace less its largest eigenvalue.
+static float EstimatePartitionError(const uint8 (*pixels)[4], uint32 subsetCount, uint32 partition, uint32 channelCount)
+{
+	int32 counts[3] = {};
+	int32 sums[3][4] = {};
+	int32 products[3][4][4] = {};
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		const uint32 subset = GetSubset(subsetCount, partition, pixel);
+		++counts[subset];
+		for (uint32 row = 0; row < channelCount; ++row)
+		{
+			sums[subset][row] += pixels[pixel][row];
+			for (uint32 column = row; column < channelCount; ++column)
+			{
+				products[subset][row][column] += pixels[pixel][row] * pixels[pixel][column];
+			}
+		}
+	}
+
+	float error = 0.0f;
+	for (uint32 subset = 0; subset < subsetCount; ++subset)
+	{
+		if (counts[subset] == 0)
+		{
+			continue;
+		}
+
+		const float inverseCount = 1.0f / static_cast<float>(counts[subset]);
+		float covariance[4][4];
+		float trace = 0.0f;
+		uint32 widest = 0;
+		for (uint32 row = 0; row < channelCount; ++row)
+		{
+			for (uint32 column = row; column < channelCount; ++column)
+			{
+				covariance[row][column] = products[subset][row][column] - sums[subset][row] * static_cast<float>(sums[subset][column]) * inverseCount;
+				covariance[column][row] = covariance[row][column];
+			}
+			trace += covariance[row][row];
+			widest = (covariance[row][row] > covariance[widest][widest]) ? row : widest;
+		}
+
+		// Starting from the widest channel's column converges in a few steps.
+		float axis[4];
+		for (uint32 channel = 0; channel < channelCount; ++channel)
+		{
+			axis[channel] = covariance[channel][widest];
+		}
+		float eigenvalue = 0.0f;
+		for (uint32 iteration = 0; iteration < 4; ++iteration)
+		{
+			float next[4] = {};
+			float axisLength = 0.0f;
+			float stretch = 0.0f;
+			for (uint32 row = 0; row < channelCount; ++row)
+			{
+				for (uint32 column = 0; column < channelCount; ++column)
+				{
+					next[row] += covariance[row][column] * axis[column];
+				}
+				axisLength += axis[row] * axis[row];
+				stretch += next[row] * axis[row];
+			}
+			if (axisLength < 1.0e-12f)
+			{
+				break;
+			}
+			eigenvalue = stretch / axisLength;
+			for (uint32 channel = 0; channel < channelCount; ++channel)
+			{
+				axis[channel] = next[channel];
+			}
+		}
+		error += trace - eigenvalue;
+	}
+	return error;
+}
+
+static SubsetFit FitSubset(const uint8 (*pixels)[4], const uint8* members, uint32 memberCount, const FitParameters& parameters)
+{
+	const uint32 lastChannel = parameters.FirstChannel + parameters.ChannelCount;
+
+	// Start from the ends of the principal axis.
+	float mean[4];
+	float axis[4];
+	GetPrincipalAxis(pixels, members, memberCount, parameters.FirstChannel, parameters.ChannelCount, mean, axis);
+
+	float minimumProjection = 0.0f;
+	float maximumProjection = 0.0f;
+	for (uint32 member = 0; member < memberCount; ++member)
+	{
+		float projection = 0.0f;
+		for (uint32 channel = parameters.FirstChannel; channel < lastChannel; ++channel)
+		{
+			projection += (pixels[members[member]][channel] - mean[channel]) * axis[channel];
+		}
+		minimumProjection = Min(minimumProjection, projection);
+		maximumProjection = Max(maximumProjection, projection);
+	}
+
+	float endpoints[2][4] = {};
+	for (uint32 channel = parameters.FirstChannel; channel < lastChannel; ++channel)
+	{
+		endpoints[0][channel] = Min(Max(mean[channel] + axis[channel] * minimumProjection, 0.0f), 255.0f);
+		endpoints[1][channel] = Min(Max(mean[channel] + axis[channel] * maximumProjection, 0.0f), 255.0f);
+	}
+
+	const uint32 pBitCombinations = (parameters.PBits == PBitMode::Unique) ? 4 : (parameters.PBits == PBitMode::Shared) ? 2 : 1;
+	const uint8* weights = GetWeights(parameters.IndexBits);
+
+	SubsetFit best = {};
+	best.Error = ~0u;
+	for (uint32 iteration = 0; iteration < parameters.Iterations; ++iteration)
+	{
+		SubsetFit candidate = {};
+		SubsetFit iterationBest = {};
+		iterationBest.Error = ~0u;
+		for (uint32 combination = 0; combination < pBitCombinations; ++combination)
+		{
+			candidate.PBits[0] = combination & 1;
+			candidate.PBits[1] = (parameters.PBits == PBitMode::Shared) ? (combination & 1) : (combination >> 1);
+
+			uint32 widened[2][4] = {};
+			for (uint32 endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				const bool hasPBit = parameters.PBits != PBitMode::None;
+				const uint32 pBit = candidate.PBits[endpoint];
+				for (uint32 channel = parameters.FirstChannel; channel < lastChannel; ++channel)
+				{
+					const uint32 code = QuantizeChannel(endpoints[endpoint][channel], parameters.EndpointBits, hasPBit, pBit);
+					candidate.Endpoints[endpoint][channel] = code;
+					widened[endpoint][channel] = hasPBit ? Unquantize((code << 1) | pBit, parameters.EndpointBits + 1)
+														 : Unquantize(code, parameters.EndpointBits);
+				}
+			}
+
+			candidate.Error = AssignIndices(pixels, members, memberCount, parameters, widened, candidate.Indices);
+			if (candidate.Error < iterationBest.Error)
+			{
+				iterationBest = candidate;
+			}
+		}
+
+		if (iterationBest.Error < best.Error)
+		{
+			best = iterationBest;
+		}
+		if (best.Error == 0 || iteration + 1 == parameters.Iterations)
+		{
+			break;
+		}
+
+		// Refit the endpoints to the chosen indices by least squares, each pixel a blend of the two at its weight.
+		float lowLow = 0.0f;
+		float lowHigh = 0.0f;
+		float highHigh = 0.0f;
+		float lowPixel[4] = {};
+		float highPixel[4] = {};
+		for (uint32 member = 0; member < memberCount; ++member)
+		{
+			const float high = weights[iterationBest.Indices[member]] / 64.0f;
+			const float low = 1.0f - high;
+			lowLow += low * low;
+			lowHigh += low * high;
+			highHigh += high * high;
+			for (uint32 channel = parameters.FirstChannel; channel < lastChannel; ++channel)
+			{
+				lowPixel[channel] += low * pixels[members[member]][channel];
+				highPixel[channel] += high * pixels[members[member]][channel];
+			}
+		}
+
+		const float determinant = lowLow * highHigh - lowHigh * lowHigh;
+		if (Absolute(determinant) < 1.0e-6f)
+		{
+			break;
+		}
+		const float inverseDeterminant = 1.0f / determinant;
+		for (uint32 channel = parameters.FirstChannel; channel < lastChannel; ++channel)
+		{
+			const float low = (highHigh * lowPixel[channel] - lowHigh * highPixel[channel]) * inverseDeterminant;
+			const float high = (lowLow * highPixel[channel] - lowHigh * lowPixel[channel]) * inverseDeterminant;
+			endpoints[0][channel] = Min(Max(low, 0.0f), 255.0f);
+			endpoints[1][channel] = Min(Max(high, 0.0f), 255.0f);
+		}
+	}
+	return best;
+}
+
+// Indices are symmetric, so a subset whose anchor index has its top bit set is stored with its endpoints swapped instead.
+static void FixAnchor(uint32 (*endpoints)[4], uint32* pBits, uint32 firstChannel, uint32 lastChannel, uint32* indices, uint32 indexBits,
+					  const bool* inSubset, uint32 anchor)
+{
+	const uint32 topBit = 1u << (indexBits - 1);
+	if ((indices[anchor] & topBit) == 0)
+	{
+		return;
+	}
+
+	for (uint32 channel = firstChannel; channel < lastChannel; ++channel)
+	{
+		const uint32 low = endpoints[0][channel];
+		endpoints[0][channel] = endpoints[1][channel];
+		endpoints[1][channel] = low;
+	}
+	if (pBits)
+	{
+		const uint32 low = pBits[0];
+		pBits[0] = pBits[1];
+		pBits[1] = low;
+	}
+
+	const uint32 maximumIndex = (1u << indexBits) - 1;
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		if (inSubset[pixel])
+		{
+			indices[pixel] = maximumIndex - indices[pixel];
+		}
+	}
+}
+
+static void EncodeMode(const uint8 (*blockPixels)[4], uint32 modeIndex, uint32 partition, uint32 rotation, uint32 indexSelection,
+					   uint32 iterations, EncodedBlock* best)
+{
+	const Bc7Mode& mode = Modes[modeIndex];
+
+	// Rotated blocks are encoded with the channel swapped into alpha, which is what the decoder swaps back.
+	uint8 pixels[16][4];
+	memcpy(pixels, blockPixels, sizeof(pixels));
+	if (rotation != 0)
+	{
+		for (uint32 pixel = 0; pixel < 16; ++pixel)
+		{
+			const uint8 alpha = pixels[pixel][3];
+			pixels[pixel][3] = pixels[pixel][rotation - 1];
+			pixels[pixel][rotation - 1] = alpha;
+		}
+	}
+
+	uint32 endpoints[6][4] = {};
+	uint32 pBits[6] = {};
+	uint32 indices[16] = {};
+	uint32 secondaryIndices[16] = {};
+	uint32 error = 0;
+
+	const PBitMode pBitMode = mode.EndpointPBits ? PBitMode::Unique : mode.SharedPBits ? PBitMode::Shared : PBitMode::None;
+	if (mode.SecondaryIndexBits == 0)
+	{
+		const uint32 channelCount = (mode.AlphaBits != 0) ? 4 : 3;
+		const FitParameters parameters = { 0, channelCount, mode.ColorBits, pBitMode, mode.IndexBits, iterations };
+
+		for (uint32 subset = 0; subset < mode.SubsetCount; ++subset)
+		{
+			uint8 members[16];
+			bool inSubset[16];
+			uint32 memberCount = 0;
+			for (uint32 pixel = 0; pixel < 16; ++pixel)
+			{
+				inSubset[pixel] = GetSubset(mode.SubsetCount, partition, pixel) == subset;
+				if (inSubset[pixel])
+				{
+					members[memberCount++] = static_cast<uint8>(pixel);
+				}
+			}
+
+			const SubsetFit fit = FitSubset(pixels, members, memberCount, parameters);
+			error += fit.Error;
+			if (error >= best->Error)
+			{
+				return;
+			}
+
+			for (uint32 member = 0; member < memberCount; ++member)
+			{
+				indices[members[member]] = fit.Indices[member];
+			}
+			memcpy(endpoints[subset * 2], fit.Endpoints, sizeof(fit.Endpoints));
+			pBits[subset * 2] = fit.PBits[0];
+			pBits[subset * 2 + 1] = fit.PBits[1];
+
+			FixAnchor(&endpoints[subset * 2], &pBits[subset * 2], 0, channelCount, indices, mode.IndexBits, inSubset,
+					  GetAnchor(mode.SubsetCount, partition, subset));
+		}
+
+		// Modes without alpha decode it as opaque.
+		if (mode.AlphaBits == 0)
+		{
+			for (uint32 pixel = 0; pixel < 16; ++pixel)
+			{
+				const uint32 difference = 255 - pixels[pixel][3];
+				error += difference * difference;
+			}
+		}
+	}
+	else
+	{
+		// Modes 4 and 5 fit color and alpha separately, each with indices of its own.
+		const uint32 colorIndexBits = (indexSelection != 0) ? mode.SecondaryIndexBits : mode.IndexBits;
+		const uint32 alphaIndexBits = (indexSelection != 0) ? mode.IndexBits : mode.SecondaryIndexBits;
+		const FitParameters colorParameters = { 0, 3, mode.ColorBits, PBitMode::None, colorIndexBits, iterations };
+		const FitParameters alphaParameters = { 3, 1, mode.AlphaBits, PBitMode::None, alphaIndexBits, iterations };
+
+		static constexpr uint8 allPixels[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+		static constexpr bool everyPixel[16] = { true, true, true, true, true, true, true, true, true, true, true, true, true, true, true, true };
+
+		const SubsetFit color = FitSubset(pixels, allPixels, 16, colorParameters);
+		const SubsetFit alpha = FitSubset(pixels, allPixels, 16, alphaParameters);
+		error = color.Error + alpha.Error;
+		if (error >= best->Error)
+		{
+			return;
+		}
+
+		uint32 colorIndices[16];
+		uint32 alphaIndices[16];
+		for (uint32 pixel = 0; pixel < 16; ++pixel)
+		{
+			colorIndices[pixel] = color.Indices[pixel];
+			alphaIndices[pixel] = alpha.Indices[pixel];
+		}
+		for (uint32 endpoint = 0; endpoint < 2; ++endpoint)
+		{
+			for (uint32 channel = 0; channel < 3; ++channel)
+			{
+				endpoints[endpoint][channel] = color.Endpoints[endpoint][channel];
+			}
+			endpoints[endpoint][3] = alpha.Endpoints[endpoint][3];
+		}
+		FixAnchor(endpoints, nullptr, 0, 3, colorIndices, colorIndexBits, everyPixel, 0);
+		FixAnchor(endpoints, nullptr, 3, 4, alphaIndices, alphaIndexBits, everyPixel, 0);
+
+		memcpy(indices, (indexSelection != 0) ? alphaIndices : colorIndices, sizeof(indices));
+		memcpy(secondaryIndices, (indexSelection != 0) ? colorIndices : alphaIndices, sizeof(secondaryIndices));
+	}
+
+	BlockWriter writer = {};
+	writer.Write(1u << modeIndex, modeIndex + 1);
+	writer.Write(partition, mode.PartitionBits);
+	writer.Write(rotation, mode.RotationBits);
+	writer.Write(indexSelection, mode.IndexSelectionBits);
+
+	const uint32 endpointCount = mode.SubsetCount * 2;
+	for (uint32 channel = 0; channel < 3; ++channel)
+	{
+		for (uint32 endpoint = 0; endpoint < endpointCount; ++endpoint)
+		{
+			writer.Write(endpoints[endpoint][channel], mode.ColorBits);
+		}
+	}
+	for (uint32 endpoint = 0; endpoint < endpointCount && mode.AlphaBits != 0; ++endpoint)
+	{
+		writer.Write(endpoints[endpoint][3], mode.AlphaBits);
+	}
+	for (uint32 endpoint = 0; endpoint < endpointCount && mode.EndpointPBits; ++endpoint)
+	{
+		writer.Write(pBits[endpoint], 1);
+	}
+	for (uint32 subset = 0; subset < mode.SubsetCount && mode.SharedPBits; ++subset)
+	{
+		writer.Write(pBits[subset * 2], 1);
+	}
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		writer.Write(indices[pixel], mode.IndexBits - (IsAnchor(mode.SubsetCount, partition, pixel) ? 1 : 0));
+	}
+	for (uint32 pixel = 0; pixel < 16 && mode.SecondaryIndexBits != 0; ++pixel)
+	{
+		writer.Write(secondaryIndices[pixel], mode.SecondaryIndexBits - (pixel == 0 ? 1 : 0));
+	}
+	CHECK(writer.Position == 128);
+
+	*best = EncodedBlock { writer.Low, writer.High, error };
+}
+
+struct PartitionEstimates
+{
+	float Errors[64];
+	uint32 Count;
+};
+
+static void EncodeBlock(const uint8 (*pixels)[4], const EncoderSettings& settings, uint8* block)
+{
+	bool isOpaque = true;
+	for (uint32 pixel = 0; pixel < 16; ++pixel)
+	{
+		isOpaque = isOpaque && pixels[pixel][3] == 255;
+	}
+
+	// By subset count, two or three, and channel count, three or four.
+	PartitionEstimates estimateCache[2][2] = {};
+
+	// Mode 6 is cheap and rarely far off, which lets the other modes give up early.
+	static constexpr uint32 modeOrder[8] = { 6, 5, 4, 1, 3, 7, 0, 2 };
+
+	EncodedBlock best = { 0, 0, ~0u };
+	for (uint32 i = 0; i < 8 && best.Error != 0; ++i)
+	{
+		const uint32 modeIndex = modeOrder[i];
+		const Bc7Mode& mode = Modes[modeIndex];
+		if ((settings.ModeMask & (1u << modeIndex)) == 0 || (mode.AlphaBits == 0 && !isOpaque))
+		{
+			continue;
+		}
+
+		if (mode.SubsetCount == 1)
+		{
+			const uint32 rotationCount = settings.AllRotations ? (1u << mode.RotationBits) : 1;
+			const uint32 indexSelectionCount = settings.AllRotations ? (1u << mode.IndexSelectionBits) : 1;
+			for (uint32 rotation = 0; rotation < rotationCount; ++rotation)
+			{
+				for (uint32 indexSelection = 0; indexSelection < indexSelectionCount; ++indexSelection)
+				{
+					EncodeMode(pixels, modeIndex, 0, rotation, indexSelection, settings.Iterations, &best);
+				}
+			}
+			continue;
+		}
+
+		// Only the partitions a line fits best are encoded for real. Modes with as many subsets and channels share estimates.
+		const uint32 partitionCount = 1u << mode.PartitionBits;
+		const uint32 channelCount = (mode.AlphaBits != 0) ? 4 : 3;
+		PartitionEstimates& cached = estimateCache[mode.SubsetCount - 2][channelCount - 3];
+		for (uint32 partition = cached.Count; partition < partitionCount; ++partition)
+		{
+			cached.Errors[partition] = EstimatePartitionError(pixels, mode.SubsetCount, partition, channelCount);
+		}
+		cached.Count = Max(cached.Count, partitionCount);
+
+		float estimates[64];
+		memcpy(estimates, cached.Errors, partitionCount * sizeof(float));
+
+		const uint32 candidateCount = Min(settings.PartitionCandidates, partitionCount);
+		for (uint32 candidate = 0; candidate < candidateCount; ++candidate)
+		{
+			uint32 partition = 0;
+			for (uint32 i = 1; i < partitionCount; ++i)
+			{
+				partition = (estimates[i] < estimates[partition]) ? i : partition;
+			}
+			estimates[partition] = 1.0e30f;
+			EncodeMode(pixels, modeIndex, partition, 0, 0, settings.Iterations, &best);
+		}
+	}
+
+	memcpy(block, &best.Low, sizeof(uint64));
+	memcpy(block + sizeof(uint64), &best.High, sizeof(uint64));
+}
+
+void EncodeBc7(const uint8* rgba, uint32 width, uint32 height, Bc7Quality quality, uint8* blocks, usize rowPitch, ThreadPool* threadPool)
+{
+	CHECK(rgba);
+	CHECK(blocks);
+	CHECK(threadPool);
+	CHECK(width != 0 && height != 0);
+
+	const EncoderSettings& settings = QualitySettings[static_cast<uint32>(quality)];
+	const uint32 blocksWide = (width + Bc7BlockDimension - 1) / Bc7BlockDimension;
+	const uint32 blocksHigh = (height + Bc7BlockDimension - 1) / Bc7BlockDimension;
+
+	threadPool->ParallelFor(blocksHigh, [&](usize blockY, usize)
+	{
+		uint8 pixels[16][4];
+		for (uint32 blockX = 0; blockX < blocksWide; ++blockX)
+		{
+			for (uint32 pixel = 0; pixel < 16; ++pixel)
+			{
+				const uint32 x = Min(blockX * Bc7BlockDimension + pixel % 4, width - 1);
+				const uint32 y = Min(static_cast<uint32>(blockY) * Bc7BlockDimension + pixel / 4, height - 1);
+				memcpy(pixels[pixel], rgba + (y * static_cast<usize>(width) + x) * 4, 4);
+			}
+			EncodeBlock(pixels, settings, blocks + blockY * rowPitch + blockX * Bc7BlockSize);
+		}
+	});
+}
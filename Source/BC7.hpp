@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Luft/Base.hpp"
+
+struct DdsImage;
+class ThreadPool;
+
+// A BC7 block encodes a 4x4 tile of RGBA8 pixels in 16 bytes.
+static constexpr uint32 Bc7BlockDimension = 4;
+static constexpr usize Bc7BlockSize = 16;
+
+enum class Bc7Quality
+{
+	// Mode 6 only, a single subset for every block.
+	Fast,
+	// The single subset modes and the two subset modes on the partitions that look most promising.
+	Normal,
+	// Every mode, rotation and index selection, on more partitions and with more refinement.
+	Best,
+};
+
+// Writes the 16 pixels of the block as RGBA8 in row order. Blocks with a reserved mode decode to transparent black.
+void DecodeBc7Block(const uint8* block, uint8* rgba);
+
+// Decodes a whole mip, blocks stored rowPitch bytes apart, into width * height RGBA8 pixels.
+void DecodeBc7(const uint8* blocks, usize rowPitch, uint32 width, uint32 height, uint8* rgba);
+
+// Decodes one subresource of a BC7 or RGBA8 image into width * height RGBA8 pixels.
+void DecodeDdsSubresource(const DdsImage& image, uint32 mipMap, uint32 arrayLayer, uint8* rgba);
+
+// Encodes width * height RGBA8 pixels into blocks stored rowPitch bytes apart, a row of blocks at a time on the thread pool.
+// Blocks that overhang the edge of the image repeat its last row and column.
+void EncodeBc7(const uint8* rgba, uint32 width, uint32 height, Bc7Quality quality, uint8* blocks, usize rowPitch, ThreadPool* threadPool);
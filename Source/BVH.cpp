@@ -0,0 +1,324 @@
+#include "BVH.hpp"
+#include "SphereSoa.hpp"
+
+#include <math.h>
+
+static constexpr usize BinCount = 16;
+
+static constexpr float TraversalCost = 1.0f;
+static constexpr float IntersectionCost = 1.0f;
+
+struct Bounds
+{
+	Vector Minimum;
+	Vector Maximum;
+};
+
+static const Bounds EmptyBounds =
+{
+	.Minimum = Vector { +INFINITY, +INFINITY, +INFINITY },
+	.Maximum = Vector { -INFINITY, -INFINITY, -INFINITY },
+};
+
+static float GetAxis(Vector v, uint32 axis)
+{
+	return axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z);
+}
+
+static Vector Minimum(Vector a, Vector b)
+{
+	return Vector { Min(a.X, b.X), Min(a.Y, b.Y), Min(a.Z, b.Z) };
+}
+
+static Vector Maximum(Vector a, Vector b)
+{
+	return Vector { Max(a.X, b.X), Max(a.Y, b.Y), Max(a.Z, b.Z) };
+}
+
+static void Grow(Bounds* bounds, const Bounds& other)
+{
+	bounds->Minimum = Minimum(bounds->Minimum, other.Minimum);
+	bounds->Maximum = Maximum(bounds->Maximum, other.Maximum);
+}
+
+static void Grow(Bounds* bounds, Vector point)
+{
+	bounds->Minimum = Minimum(bounds->Minimum, point);
+	bounds->Maximum = Maximum(bounds->Maximum, point);
+}
+
+static float GetSurfaceArea(const Bounds& bounds)
+{
+	const Vector extent = bounds.Maximum - bounds.Minimum;
+	if (extent.X < 0.0f)
+	{
+		return 0.0f;
+	}
+	return 2.0f * (extent.X * extent.Y + extent.Y * extent.Z + extent.Z * extent.X);
+}
+
+static Vector GetCentroid(const Hlsl::Sphere& sphere)
+{
+	return Vector { sphere.Position.X, sphere.Position.Y, sphere.Position.Z };
+}
+
+static Bounds GetBounds(const Hlsl::Sphere& sphere)
+{
+	const Vector center = GetCentroid(sphere);
+	const Vector extent = Vector { sphere.Radius, sphere.Radius, sphere.Radius };
+	return Bounds { center - extent, center + extent };
+}
+
+struct BuildContext
+{
+	Hlsl::Sphere* Spheres;
+	Array<Bounds> SphereBounds;
+	usize MaxLeafCount;
+	Array<Hlsl::BvhNode> Nodes;
+};
+
+static void SwapSpheres(BuildContext* context, usize a, usize b)
+{
+	const Hlsl::Sphere sphere = context->Spheres[a];
+	context->Spheres[a] = context->Spheres[b];
+	context->Spheres[b] = sphere;
+
+	const Bounds bounds = context->SphereBounds[a];
+	context->SphereBounds[a] = context->SphereBounds[b];
+	context->SphereBounds[b] = bounds;
+}
+
+static usize BuildNode(BuildContext* context, usize first, usize count, uint32 depth)
+{
+	Bounds bounds = EmptyBounds;
+	Bounds centroidBounds = EmptyBounds;
+	for (usize i = first; i < first + count; ++i)
+	{
+		Grow(&bounds, context->SphereBounds[i]);
+		Grow(&centroidBounds, GetCentroid(context->Spheres[i]));
+	}
+
+	const usize nodeIndex = context->Nodes.GetLength();
+	context->Nodes.Add(Hlsl::BvhNode
+	{
+		.Minimum = Float3 { bounds.Minimum.X, bounds.Minimum.Y, bounds.Minimum.Z },
+		.Offset = static_cast<uint32>(first),
+		.Maximum = Float3 { bounds.Maximum.X, bounds.Maximum.Y, bounds.Maximum.Z },
+		.CountAndAxis = static_cast<uint32>(count),
+	});
+
+	// The traversal stack holds at most one entry per level, so force a leaf before it could overflow.
+	if (count <= 1 || depth + 1 >= Hlsl::BvhMaxDepth)
+	{
+		VERIFY(count <= Hlsl::BvhLeafCountMask, "Too many spheres in a BVH leaf!");
+		return nodeIndex;
+	}
+
+	struct Bin
+	{
+		Bounds Bounds;
+		usize Count;
+	};
+
+	float bestCost = INFINITY;
+	uint32 bestAxis = 0;
+	usize bestSplit = 0;
+
+	for (uint32 axis = 0; axis < 3; ++axis)
+	{
+		const float axisMinimum = GetAxis(centroidBounds.Minimum, axis);
+		const float axisExtent = GetAxis(centroidBounds.Maximum, axis) - axisMinimum;
+		if (axisExtent <= 0.0f)
+		{
+			continue;
+		}
+		const float binScale = static_cast<float>(BinCount) / axisExtent;
+
+		Bin bins[BinCount];
+		for (Bin& bin : bins)
+		{
+			bin = Bin { EmptyBounds, 0 };
+		}
+
+		for (usize i = first; i < first + count; ++i)
+		{
+			const float centroid = GetAxis(GetCentroid(context->Spheres[i]), axis);
+			const usize binIndex = Min(static_cast<usize>((centroid - axisMinimum) * binScale), BinCount - 1);
+			Grow(&bins[binIndex].Bounds, context->SphereBounds[i]);
+			++bins[binIndex].Count;
+		}
+
+		float rightAreas[BinCount - 1];
+		usize rightCounts[BinCount - 1];
+		Bounds rightBounds = EmptyBounds;
+		usize rightCount = 0;
+		for (usize i = BinCount - 1; i > 0; --i)
+		{
+			Grow(&rightBounds, bins[i].Bounds);
+			rightCount += bins[i].Count;
+			rightAreas[i - 1] = GetSurfaceArea(rightBounds);
+			rightCounts[i - 1] = rightCount;
+		}
+
+		Bounds leftBounds = EmptyBounds;
+		usize leftCount = 0;
+		for (usize i = 0; i < BinCount - 1; ++i)
+		{
+			Grow(&leftBounds, bins[i].Bounds);
+			leftCount += bins[i].Count;
+
+			if (leftCount == 0 || rightCounts[i] == 0)
+			{
+				continue;
+			}
+			const float cost = GetSurfaceArea(leftBounds) * static_cast<float>(leftCount) + rightAreas[i] * static_cast<float>(rightCounts[i]);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	const float leafCost = IntersectionCost * static_cast<float>(count);
+	const float splitCost = TraversalCost + IntersectionCost * bestCost / GetSurfaceArea(bounds);
+	const bool canSplit = bestCost != INFINITY;
+	if (!canSplit || (count <= context->MaxLeafCount && leafCost <= splitCost))
+	{
+		VERIFY(count <= Hlsl::BvhLeafCountMask, "Too many spheres in a BVH leaf!");
+		return nodeIndex;
+	}
+
+	const float axisMinimum = GetAxis(centroidBounds.Minimum, bestAxis);
+	const float binScale = static_cast<float>(BinCount) / (GetAxis(centroidBounds.Maximum, bestAxis) - axisMinimum);
+
+	usize middle = first;
+	for (usize i = first; i < first + count; ++i)
+	{
+		const float centroid = GetAxis(GetCentroid(context->Spheres[i]), bestAxis);
+		const usize binIndex = Min(static_cast<usize>((centroid - axisMinimum) * binScale), BinCount - 1);
+		if (binIndex <= bestSplit)
+		{
+			SwapSpheres(context, i, middle);
+			++middle;
+		}
+	}
+	CHECK(middle != first && middle != first + count);
+
+	const usize leftCount = middle - first;
+	BuildNode(context, first, leftCount, depth + 1);
+	const usize secondChild = BuildNode(context, middle, count - leftCount, depth + 1);
+
+	Hlsl::BvhNode& node = context->Nodes[nodeIndex];
+	node.Offset = static_cast<uint32>(secondChild);
+	node.CountAndAxis = bestAxis << Hlsl::BvhAxisShift;
+
+	return nodeIndex;
+}
+
+Array<Hlsl::BvhNode> BuildBvh(Array<Hlsl::Sphere>* spheres, usize maxLeafCount)
+{
+	CHECK(spheres);
+
+	BuildContext context =
+	{
+		.Spheres = spheres->GetData(),
+		.SphereBounds = Array<Bounds> { &GlobalAllocator::Get() },
+		.MaxLeafCount = maxLeafCount,
+		.Nodes = Array<Hlsl::BvhNode> { &GlobalAllocator::Get() },
+	};
+	if (spheres->IsEmpty())
+	{
+		return Move(context.Nodes);
+	}
+
+	context.SphereBounds.GrowToLengthUninitialized(spheres->GetLength());
+	for (usize i = 0; i < spheres->GetLength(); ++i)
+	{
+		context.SphereBounds[i] = GetBounds((*spheres)[i]);
+	}
+
+	BuildNode(&context, 0, spheres->GetLength(), 0);
+
+	return Move(context.Nodes);
+}
+
+bool IsValidHit(const BvhHit& hit)
+{
+	return hit.Time >= 0.0f;
+}
+
+static bool RayBounds(const Hlsl::BvhNode& node, Vector rayOrigin, Vector inverseRayDirection, float rayMinT, float rayMaxT)
+{
+	const float x0 = (node.Minimum.X - rayOrigin.X) * inverseRayDirection.X;
+	const float x1 = (node.Maximum.X - rayOrigin.X) * inverseRayDirection.X;
+	const float y0 = (node.Minimum.Y - rayOrigin.Y) * inverseRayDirection.Y;
+	const float y1 = (node.Maximum.Y - rayOrigin.Y) * inverseRayDirection.Y;
+	const float z0 = (node.Minimum.Z - rayOrigin.Z) * inverseRayDirection.Z;
+	const float z1 = (node.Maximum.Z - rayOrigin.Z) * inverseRayDirection.Z;
+
+	const float entry = Max(Max(Min(x0, x1), Min(y0, y1)), Max(Min(z0, z1), rayMinT));
+	const float exit = Min(Min(Max(x0, x1), Max(y0, y1)), Min(Max(z0, z1), rayMaxT));
+	return entry <= exit;
+}
+
+BvhHit TraverseBvh(const Hlsl::BvhNode* nodes, const SphereSoa& spheres, Vector rayOrigin, Vector rayDirection, float rayMinT, float rayMaxT)
+{
+	BvhHit hit = { -1.0f, 0 };
+	if (!nodes)
+	{
+		return hit;
+	}
+
+	const Vector inverseRayDirection = Vector { 1.0f / rayDirection.X, 1.0f / rayDirection.Y, 1.0f / rayDirection.Z };
+	const bool directionNegative[3] = { rayDirection.X < 0.0f, rayDirection.Y < 0.0f, rayDirection.Z < 0.0f };
+
+	uint32 stack[Hlsl::BvhMaxDepth];
+	uint32 stackSize = 0;
+	uint32 nodeIndex = 0;
+
+	while (true)
+	{
+		const Hlsl::BvhNode& node = nodes[nodeIndex];
+		if (RayBounds(node, rayOrigin, inverseRayDirection, rayMinT, rayMaxT))
+		{
+			const uint32 count = node.CountAndAxis & Hlsl::BvhLeafCountMask;
+			if (count != 0)
+			{
+				IntersectSpheres(spheres, node.Offset, count, rayOrigin, rayDirection, rayMinT, &rayMaxT, &hit);
+			}
+			else
+			{
+				// Visit the child nearer along the split axis first so the shrinking rayMaxT culls more of the other.
+				const uint32 axis = node.CountAndAxis >> Hlsl::BvhAxisShift;
+				if (directionNegative[axis])
+				{
+					stack[stackSize++] = nodeIndex + 1;
+					nodeIndex = node.Offset;
+				}
+				else
+				{
+					stack[stackSize++] = node.Offset;
+					nodeIndex = nodeIndex + 1;
+				}
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackSize];
+	}
+
+	return hit;
+}
+
+BvhHit TraverseLinear(const SphereSoa& spheres, Vector rayOrigin, Vector rayDirection, float rayMinT, float rayMaxT)
+{
+	BvhHit hit = { -1.0f, 0 };
+	IntersectSpheres(spheres, 0, spheres.Count, rayOrigin, rayDirection, rayMinT, &rayMaxT, &hit);
+	return hit;
+}
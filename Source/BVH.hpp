@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Trace.hpp"
+
+#include "Luft/Array.hpp"
+
+struct SphereSoa;
+
+static constexpr usize BvhDefaultLeafCount = 4;
+
+struct BvhHit
+{
+	float Time;
+	uint32 SphereIndex;
+};
+
+bool IsValidHit(const BvhHit& hit);
+
+Array<Hlsl::BvhNode> BuildBvh(Array<Hlsl::Sphere>* spheres, usize maxLeafCount = BvhDefaultLeafCount);
+
+BvhHit TraverseBvh(const Hlsl::BvhNode* nodes, const SphereSoa& spheres, Vector rayOrigin, Vector rayDirection, float rayMinT, float rayMaxT);
+BvhHit TraverseLinear(const SphereSoa& spheres, Vector rayOrigin, Vector rayDirection, float rayMinT, float rayMaxT);
@@ -0,0 +1,373 @@
+#include "CommandLine.hpp"
+#include "Decimal.hpp"
+#include "File.hpp"
+#include "GlyphTable.hpp"
+#include "JSON.hpp"
+#include "Log.hpp"
+
+#include "Luft/HashTable.hpp"
+#include "Luft/Math.hpp"
+
+#include <stdlib.h>
+
+static bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// The number parser JSON used before ParseDecimal, kept to measure against. It accumulates the fraction in a uint64 that
+// overflows past 19 digits, scales by an integer power of ten that overflows past 10^19 and rounds more than once.
+static uint64 LegacyParseUint64(StringView buffer, usize* index)
+{
+	usize offset = 0;
+	uint64 factor = 1;
+	while (*index + offset < buffer.GetLength() && IsDigit(buffer[*index + offset]))
+	{
+		++offset;
+		factor *= 10;
+	}
+	VERIFY(offset != 0, "Expected to read a number and failed!");
+
+	uint64 result = 0;
+	for (usize i = 0; i < offset; ++i)
+	{
+		factor /= 10;
+		result += factor * (buffer[*index + i] - '0');
+	}
+
+	*index += offset;
+	return result;
+}
+
+static int64 LegacyParseInt64(StringView buffer, usize* index)
+{
+	const bool isNegative = buffer[*index] == '-';
+	const bool isSign = isNegative || buffer[*index] == '+';
+	if (isSign)
+	{
+		*index += 1;
+	}
+	const int64 value = static_cast<int64>(LegacyParseUint64(buffer, index));
+	return isNegative ? -value : value;
+}
+
+static double LegacyParseDecimal(StringView buffer, usize* index)
+{
+	const bool isNegative = buffer[*index] == '-';
+	const int64 whole = LegacyParseInt64(buffer, index);
+
+	uint64 fractional = 0;
+	uint64 divisor = 1;
+	if (*index < buffer.GetLength() && buffer[*index] == '.')
+	{
+		*index += 1;
+		if (*index < buffer.GetLength() && IsDigit(buffer[*index]))
+		{
+			const usize startingIndex = *index;
+			fractional = LegacyParseUint64(buffer, index);
+
+			usize fractionalLength = *index - startingIndex;
+			while (fractionalLength != 0)
+			{
+				divisor *= 10;
+				--fractionalLength;
+			}
+		}
+	}
+
+	const float factor = isNegative ? -1.0f : 1.0f;
+	const double mantissa = static_cast<double>(whole) + factor * (static_cast<double>(fractional) / static_cast<double>(divisor));
+
+	int64 exponent = 0;
+	if (*index < buffer.GetLength() && (buffer[*index] == 'e' || buffer[*index] == 'E'))
+	{
+		*index += 1;
+		exponent = LegacyParseInt64(buffer, index);
+	}
+
+	const double power = static_cast<double>(Power10(Absolute(exponent)));
+	const double multiplier = (exponent >= 0) ? power : (1.0 / power);
+	return mantissa * multiplier;
+}
+
+// Offsets of every number outside a string. Good enough for well-formed files, which is all the benchmark reads.
+static Array<usize> FindNumbers(StringView buffer)
+{
+	Array<usize> numbers(&GlobalAllocator::Get());
+
+	bool inString = false;
+	bool inNumber = false;
+	for (usize i = 0; i < buffer.GetLength(); ++i)
+	{
+		const char c = buffer[i];
+		if (inString)
+		{
+			i += (c == '\\') ? 1 : 0;
+			inString = c != '"';
+			continue;
+		}
+
+		const bool isNumberCharacter = IsDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+		if (isNumberCharacter && !inNumber && (IsDigit(c) || c == '-'))
+		{
+			numbers.Add(i);
+		}
+		inNumber = isNumberCharacter;
+		inString = c == '"';
+	}
+	return numbers;
+}
+
+struct ParserResult
+{
+	double NanosecondsPerNumber;
+	double MegabytesPerSecond;
+	usize Mismatches;
+};
+
+template<typename F>
+static ParserResult MeasureParser(StringView buffer, const Array<usize>& numbers, usize numberBytes, const Array<double>& expected, const F& parse)
+{
+	static constexpr usize iterationCount = 200;
+
+	ParserResult result = {};
+	for (usize i = 0; i < numbers.GetLength(); ++i)
+	{
+		usize index = numbers[i];
+		const double value = parse(buffer, &index);
+		result.Mismatches += (value != expected[i]) ? 1 : 0;
+	}
+
+	// The fastest iteration is the one least disturbed by the rest of the machine.
+	double bestSeconds = 1.0e30;
+	double sum = 0.0;
+	for (usize iteration = 0; iteration < iterationCount; ++iteration)
+	{
+		const double start = Platform::GetTime();
+		for (usize i = 0; i < numbers.GetLength(); ++i)
+		{
+			usize index = numbers[i];
+			sum += parse(buffer, &index);
+		}
+		bestSeconds = Min(bestSeconds, Platform::GetTime() - start);
+	}
+	VERIFY(sum == sum || numbers.IsEmpty(), "Parsed a number that is not a number!");
+
+	result.NanosecondsPerNumber = bestSeconds * 1.0e9 / static_cast<double>(Max<usize>(numbers.GetLength(), 1));
+	result.MegabytesPerSecond = static_cast<double>(numberBytes) / bestSeconds / 1.0e6;
+	return result;
+}
+
+// What a line of the debug overlay looks like, the glyph lookups are the same whatever the font.
+static constexpr char OverlayText[] = "Frame 16.67 ms (60.0 fps), GPU 11.42 ms, 1920x1080, 64 samples per pixel, 4095 BVH nodes";
+
+struct GlyphLookupResult
+{
+	double NanosecondsPerCharacter;
+	float Width;
+};
+
+template<typename F>
+static GlyphLookupResult MeasureGlyphLookup(StringView text, const F& lookup)
+{
+	static constexpr usize iterationCount = 20000;
+
+	GlyphLookupResult result = {};
+	for (usize i = 0; i < text.GetLength(); ++i)
+	{
+		result.Width += lookup(text[i]).Advance;
+	}
+
+	double bestSeconds = 1.0e30;
+	float sum = 0.0f;
+	for (usize iteration = 0; iteration < iterationCount; ++iteration)
+	{
+		const double start = Platform::GetTime();
+		for (usize i = 0; i < text.GetLength(); ++i)
+		{
+			sum += lookup(text[i]).Advance;
+		}
+		bestSeconds = Min(bestSeconds, Platform::GetTime() - start);
+	}
+	VERIFY(sum == sum, "Laid out a glyph that is not a number!");
+
+	result.NanosecondsPerCharacter = bestSeconds * 1.0e9 / static_cast<double>(Max<usize>(text.GetLength(), 1));
+	return result;
+}
+
+// Looks the same glyphs up through GlyphTable and through the hash table DrawText used before it.
+static void MeasureGlyphLookups()
+{
+	HashTable<char, Glyph> hashTable(64);
+	GlyphTable glyphTable;
+	for (char c = ' '; c <= '~'; ++c)
+	{
+		const Glyph glyph =
+		{
+			.AtlasPosition = { 0.0f, 0.0f },
+			.AtlasSize = { 0.0f, 0.0f },
+			.PlanePosition = { 0.0f, 0.0f },
+			.PlaneSize = { 0.0f, 0.0f },
+			.Advance = 0.25f + static_cast<float>(c - ' ') / 256.0f,
+		};
+		hashTable.Add(c, glyph);
+		glyphTable.Add(static_cast<uint32>(c), glyph);
+	}
+	glyphTable.Build();
+
+	const StringView text = { OverlayText, sizeof(OverlayText) - 1 };
+	const GlyphLookupResult hashed = MeasureGlyphLookup(text, [&](char c) -> const Glyph& { return hashTable[c]; });
+	const GlyphLookupResult indexed = MeasureGlyphLookup(text, [&](char c) -> const Glyph& { return glyphTable.Get(static_cast<uint8>(c)); });
+	VERIFY(hashed.Width == indexed.Width, "Glyph tables disagree!");
+
+	Log("Benchmark: HashTable    %6.2f ns/glyph\n", hashed.NanosecondsPerCharacter);
+	Log("Benchmark: GlyphTable   %6.2f ns/glyph over %zu pages\n", indexed.NanosecondsPerCharacter, glyphTable.GetPageCount());
+}
+
+static usize CompareJsonValue(JsonCursor* cursor, const JsonValue& value);
+
+// Walks the cursor and the DOM together and returns how many values differ, counting a missing or extra value as one.
+static usize CompareJsonObject(JsonCursor* cursor, const JsonObject& object)
+{
+	usize mismatches = 0;
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (!object.HasKey(key))
+		{
+			cursor->SkipValue();
+			++mismatches;
+			continue;
+		}
+		mismatches += CompareJsonValue(cursor, object[key]);
+	}
+	return mismatches;
+}
+
+static usize CompareJsonValue(JsonCursor* cursor, const JsonValue& value)
+{
+	const JsonTag tag = cursor->PeekTag();
+	if (tag != value.GetTag())
+	{
+		cursor->SkipValue();
+		return 1;
+	}
+
+	switch (tag)
+	{
+	case JsonTag::Object:
+		return CompareJsonObject(cursor, value.GetObject());
+	case JsonTag::Array:
+	{
+		const JsonArray& array = value.GetArray();
+		usize mismatches = 0;
+		usize index = 0;
+		cursor->BeginArray();
+		while (cursor->NextElement())
+		{
+			if (index < array.GetLength())
+			{
+				mismatches += CompareJsonValue(cursor, array[index]);
+			}
+			else
+			{
+				cursor->SkipValue();
+				++mismatches;
+			}
+			++index;
+		}
+		return mismatches + ((index < array.GetLength()) ? array.GetLength() - index : 0);
+	}
+	case JsonTag::String:
+		return (cursor->ReadString() == value.GetString()) ? 0 : 1;
+	case JsonTag::Decimal:
+		return (cursor->ReadDecimal() == value.GetDecimal()) ? 0 : 1;
+	case JsonTag::Boolean:
+		return (cursor->ReadBoolean() == value.GetBoolean()) ? 0 : 1;
+	case JsonTag::Null:
+		cursor->ReadNull();
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+// Loads the file into the heap DOM and into JsonDocument, whose arena, in situ strings and arrays parsed in runs on the
+// thread pool are what it is measured for, then checks the document against the tape.
+static void MeasureDocumentLoads(StringView filePath)
+{
+	static constexpr usize iterationCount = 10;
+
+	// Both are timed from the file to the freed DOM, freeing is part of what the arena saves.
+	double heapSeconds = 1.0e30;
+	double documentSeconds = 1.0e30;
+	for (usize iteration = 0; iteration < iterationCount; ++iteration)
+	{
+		const double heapStart = Platform::GetTime();
+		{
+			const JsonObject root = LoadJson(filePath);
+		}
+		heapSeconds = Min(heapSeconds, Platform::GetTime() - heapStart);
+
+		const double documentStart = Platform::GetTime();
+		{
+			const JsonDocument document(filePath);
+		}
+		documentSeconds = Min(documentSeconds, Platform::GetTime() - documentStart);
+	}
+
+	const JsonDocument document(filePath);
+	const JsonTapeFile tapeFile(filePath);
+	JsonCursor cursor = tapeFile.GetCursor();
+	const usize mismatches = CompareJsonObject(&cursor, document.GetRoot());
+
+	Log("Benchmark: LoadJson     %8.3f ms/document\n", heapSeconds * 1000.0);
+	Log("Benchmark: JsonDocument %8.3f ms/document in %zu KiB, %zu values differ from the tape\n", documentSeconds * 1000.0,
+		document.GetMemoryUsed() / 1024, mismatches);
+}
+
+void Start()
+{
+	const Array<StringView> arguments = GetCommandLineArguments();
+	if (arguments.GetLength() > 1)
+	{
+		Platform::Log("Usage: EosBenchmark [file.json]\n"
+					  "Times the JSON number parser against the previous implementation on every number in the file,\n"
+					  "loading the whole file with LoadJson against JsonDocument, then glyph lookups through GlyphTable\n"
+					  "against the hash table DrawText used before it.\n");
+		return;
+	}
+	const StringView filePath = arguments.IsEmpty() ? "Assets/Fonts/RobotoMSDF.json"_view : arguments[0];
+
+	const MappedFile file(filePath);
+	const StringView buffer = file.GetView();
+
+	const Array<usize> numbers = FindNumbers(buffer);
+
+	// The C runtime is the reference for correct rounding.
+	Array<double> expected(&GlobalAllocator::Get());
+	usize numberBytes = 0;
+	for (const usize number : numbers)
+	{
+		usize end = number;
+		ParseDecimal(buffer, &end);
+		numberBytes += end - number;
+
+		char text[512] = {};
+		VERIFY(end - number < sizeof(text), "Number is too long for the benchmark!");
+		Platform::MemoryCopy(text, buffer.GetData() + number, end - number);
+		expected.Add(strtod(text, nullptr));
+	}
+	Log("Benchmark: %zu numbers in %zu bytes of %.*s\n", numbers.GetLength(), numberBytes, static_cast<int>(filePath.GetLength()), filePath.GetData());
+
+	const ParserResult legacy = MeasureParser(buffer, numbers, numberBytes, expected, LegacyParseDecimal);
+	const ParserResult decimal = MeasureParser(buffer, numbers, numberBytes, expected, ParseDecimal);
+
+	Log("Benchmark: legacy       %6.2f ns/number %8.1f MB/s, %zu differ from strtod\n", legacy.NanosecondsPerNumber, legacy.MegabytesPerSecond, legacy.Mismatches);
+	Log("Benchmark: ParseDecimal %6.2f ns/number %8.1f MB/s, %zu differ from strtod\n", decimal.NanosecondsPerNumber, decimal.MegabytesPerSecond, decimal.Mismatches);
+
+	MeasureDocumentLoads(filePath);
+
+	MeasureGlyphLookups();
+}
@@ -19,6 +19,18 @@ CameraController::CameraController()
 {
 }
 
+void CameraController::SetView(const Vector& position, float yawRadians, float pitchRadians)
+{
+	PitchRadians = Min(Max(pitchRadians, -Pi / 2.0f), +Pi / 2.0f);
+
+	Position = position;
+	Orientation = Quaternion::AxisAngle(Vector { +0.0f, +1.0f, +0.0f }, yawRadians);
+	Orientation = Quaternion::AxisAngle(Orientation.Rotate(Vector { +1.0f, +0.0f, +0.0f }), PitchRadians) * Orientation;
+	Orientation = Orientation.GetNormalized();
+
+	LastMoved = 0;
+}
+
 void CameraController::Update(float timeDelta)
 {
 	bool mouseMoved = false;
@@ -9,6 +9,9 @@ public:
 
 	void Update(float timeDelta);
 
+	// Yaw turns about the world up axis, then pitch about the camera's side axis, from the default view down -Z.
+	void SetView(const Vector& position, float yawRadians, float pitchRadians);
+
 	Vector GetPosition() const { return Position; }
 	Matrix GetOrientation() const
 	{
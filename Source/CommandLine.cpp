@@ -0,0 +1,122 @@
+#include "CommandLine.hpp"
+
+#include <stdlib.h>
+
+#if WINDOWS
+
+Array<StringView> GetCommandLineArguments()
+{
+	Array<StringView> arguments(&GlobalAllocator::Get());
+	for (int32 i = 1; i < __argc; ++i)
+	{
+		arguments.Add(StringView { __argv[i], Platform::StringLength(__argv[i]) });
+	}
+	return arguments;
+}
+
+#else
+
+#include <stdio.h>
+
+static const Array<char>& ReadProcessCommandLine()
+{
+	// Read once and kept for the lifetime of the process, like the CRT's argv.
+	static Array<char> commandLine(&GlobalAllocator::Get());
+	if (commandLine.IsEmpty())
+	{
+		FILE* file = fopen("/proc/self/cmdline", "rb");
+		VERIFY(file, "Failed to read the command line!");
+
+		char chunk[256];
+		usize readSize;
+		while ((readSize = fread(chunk, 1, sizeof(chunk), file)) != 0)
+		{
+			for (usize i = 0; i < readSize; ++i)
+			{
+				commandLine.Add(chunk[i]);
+			}
+		}
+		fclose(file);
+	}
+	return commandLine;
+}
+
+Array<StringView> GetCommandLineArguments()
+{
+	const Array<char>& commandLine = ReadProcessCommandLine();
+
+	Array<StringView> arguments(&GlobalAllocator::Get());
+
+	usize start = 0;
+	bool isExecutable = true;
+	for (usize i = 0; i < commandLine.GetLength(); ++i)
+	{
+		if (commandLine[i] == '\0')
+		{
+			if (!isExecutable)
+			{
+				arguments.Add(StringView { commandLine.GetData() + start, i - start });
+			}
+			isExecutable = false;
+			start = i + 1;
+		}
+	}
+	return arguments;
+}
+
+#endif
+
+StringView FindCommandLineValue(const Array<StringView>& arguments, StringView option)
+{
+	for (usize i = 0; i + 1 < arguments.GetLength(); ++i)
+	{
+		if (arguments[i] == option)
+		{
+			return arguments[i + 1];
+		}
+	}
+	return StringView {};
+}
+
+bool ParseCommandLineUint32(StringView argument, uint32* value)
+{
+	CHECK(value);
+	if (argument.GetLength() == 0)
+	{
+		return false;
+	}
+
+	uint64 result = 0;
+	for (usize i = 0; i < argument.GetLength(); ++i)
+	{
+		const char c = argument[i];
+		if (c < '0' || c > '9')
+		{
+			return false;
+		}
+		result = result * 10 + static_cast<uint64>(c - '0');
+		if (result > 0xFFFFFFFF)
+		{
+			return false;
+		}
+	}
+	*value = static_cast<uint32>(result);
+	return true;
+}
+
+bool ParseCommandLineDouble(StringView argument, double* value)
+{
+	CHECK(value);
+
+	char text[64];
+	if (argument.GetLength() == 0 || argument.GetLength() >= sizeof(text))
+	{
+		return false;
+	}
+	Platform::MemoryCopy(text, argument.GetData(), argument.GetLength());
+	text[argument.GetLength()] = '\0';
+
+	char* end = nullptr;
+	*value = strtod(text, &end);
+	return end == text + argument.GetLength();
+}
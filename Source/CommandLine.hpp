@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Luft/Array.hpp"
+#include "Luft/String.hpp"
+
+// The program arguments, excluding the executable path.
+Array<StringView> GetCommandLineArguments();
+
+// The argument following the first occurrence of option, or an empty view when the option is missing or has no value.
+StringView FindCommandLineValue(const Array<StringView>& arguments, StringView option);
+
+bool ParseCommandLineUint32(StringView argument, uint32* value);
+bool ParseCommandLineDouble(StringView argument, double* value);
@@ -0,0 +1,318 @@
+#include "BC7.hpp"
+#include "CommandLine.hpp"
+#include "DDS.hpp"
+#include "Image.hpp"
+#include "Log.hpp"
+#include "MipMaps.hpp"
+#include "ThreadPool.hpp"
+
+#include <math.h>
+
+struct CookerSettings
+{
+	StringView InputPath;
+	StringView OutputPath;
+
+	TextureFormat Format;
+	MipMapFilter Filter;
+	Bc7Quality Quality;
+
+	// Zero for the full chain down to 1x1.
+	uint32 MipMapCount;
+};
+
+static void LogUsage()
+{
+	Platform::Log("Usage: EosCooker --input <file.pfm|file.dds> --output <file.dds> [--format <rgba8|rgba8-srgb|rgba32f|bc7|bc7-srgb>]\n"
+				  "                 [--filter <box|kaiser>] [--quality <fast|normal|best>] [--mips <count>]\n"
+				  "Generates the mips of an image and writes them as a load-ready DDS texture.\n"
+				  "PFM inputs are linear, and DDS inputs are read from the first mip of their first layer.\n");
+}
+
+static bool ParseFormat(StringView argument, TextureFormat* format)
+{
+	if (argument == "rgba8"_view)
+	{
+		*format = TextureFormat::Rgba8Unorm;
+	}
+	else if (argument == "rgba8-srgb"_view)
+	{
+		*format = TextureFormat::Rgba8SrgbUnorm;
+	}
+	else if (argument == "rgba32f"_view)
+	{
+		*format = TextureFormat::Rgba32Float;
+	}
+	else if (argument == "bc7"_view)
+	{
+		*format = TextureFormat::Bc7Unorm;
+	}
+	else if (argument == "bc7-srgb"_view)
+	{
+		*format = TextureFormat::Bc7SrgbUnorm;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+static bool ParseSettings(const Array<StringView>& arguments, CookerSettings* settings)
+{
+	CHECK(settings);
+
+	for (usize i = 0; i < arguments.GetLength(); ++i)
+	{
+		const StringView argument = arguments[i];
+		const bool hasValue = i + 1 < arguments.GetLength();
+
+		bool valid = true;
+		if (argument == "--input"_view && hasValue)
+		{
+			settings->InputPath = arguments[++i];
+		}
+		else if (argument == "--output"_view && hasValue)
+		{
+			settings->OutputPath = arguments[++i];
+		}
+		else if (argument == "--format"_view && hasValue)
+		{
+			valid = ParseFormat(arguments[++i], &settings->Format);
+		}
+		else if (argument == "--filter"_view && hasValue)
+		{
+			const StringView filter = arguments[++i];
+			settings->Filter = (filter == "box"_view) ? MipMapFilter::Box : MipMapFilter::Kaiser;
+			valid = filter == "box"_view || filter == "kaiser"_view;
+		}
+		else if (argument == "--quality"_view && hasValue)
+		{
+			const StringView quality = arguments[++i];
+			settings->Quality = (quality == "fast"_view) ? Bc7Quality::Fast : (quality == "best"_view) ? Bc7Quality::Best : Bc7Quality::Normal;
+			valid = quality == "fast"_view || quality == "normal"_view || quality == "best"_view;
+		}
+		else if (argument == "--mips"_view && hasValue)
+		{
+			valid = ParseCommandLineUint32(arguments[++i], &settings->MipMapCount) && settings->MipMapCount != 0;
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			return false;
+		}
+	}
+	return !settings->InputPath.IsEmpty() && !settings->OutputPath.IsEmpty();
+}
+
+static float SrgbToLinear(float x)
+{
+	return x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float x)
+{
+	return x < 0.0031308f ? x * 12.92f : powf(x, 1.0f / 2.4f) * 1.055f - 0.055f;
+}
+
+static bool IsSrgb(TextureFormat format)
+{
+	return format == TextureFormat::Rgba8SrgbUnorm || format == TextureFormat::Bc7SrgbUnorm;
+}
+
+static bool ReadSourceImage(StringView filePath, Array<Float4>* pixels, uint32* width, uint32* height)
+{
+	if (GetImageFileFormat(filePath) == ImageFileFormat::Pfm)
+	{
+		Array<Float3> colors(&GlobalAllocator::Get());
+		if (!ReadPfmImage(filePath, &colors, width, height))
+		{
+			return false;
+		}
+		pixels->GrowToLengthUninitialized(colors.GetLength());
+		for (usize i = 0; i < colors.GetLength(); ++i)
+		{
+			(*pixels)[i] = Float4 { colors[i].X, colors[i].Y, colors[i].Z, 1.0f };
+		}
+		return true;
+	}
+
+	DdsImage image = LoadDdsImage(filePath);
+	*width = image.Width;
+	*height = image.Height;
+	pixels->GrowToLengthUninitialized(static_cast<usize>(image.Width) * image.Height);
+
+	const DdsSubresource& top = image.GetSubresource(0, 0);
+	if (image.Format == TextureFormat::Rgba32Float)
+	{
+		for (uint32 y = 0; y < image.Height; ++y)
+		{
+			Platform::MemoryCopy(pixels->GetData() + static_cast<usize>(y) * image.Width, image.Data + top.Offset + y * top.RowPitch,
+								 image.Width * sizeof(Float4));
+		}
+	}
+	else
+	{
+		Array<uint8> rgba(&GlobalAllocator::Get());
+		rgba.GrowToLengthUninitialized(static_cast<usize>(image.Width) * image.Height * 4);
+		DecodeDdsSubresource(image, 0, 0, rgba.GetData());
+
+		float toLinear[256];
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			const float value = static_cast<float>(i) / 255.0f;
+			toLinear[i] = IsSrgb(image.Format) ? SrgbToLinear(value) : value;
+		}
+		for (usize i = 0; i < pixels->GetLength(); ++i)
+		{
+			const uint8* pixel = &rgba[i * 4];
+			(*pixels)[i] = Float4 { toLinear[pixel[0]], toLinear[pixel[1]], toLinear[pixel[2]], static_cast<float>(pixel[3]) / 255.0f };
+		}
+	}
+
+	UnloadDdsImage(&image);
+	return true;
+}
+
+static uint8 ToUnorm8(float x)
+{
+	return static_cast<uint8>(Min(Max(x, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// The filters overshoot at hard edges, so colors are clamped to be positive and alpha to the unit range.
+static void WriteSubresource(const Float4* pixels, const DdsSubresource& subresource, const CookerSettings& settings, uint8* data,
+							 ThreadPool* threadPool)
+{
+	const uint32 width = subresource.Width;
+	const uint32 height = subresource.Height;
+	uint8* output = data + subresource.Offset;
+
+	if (settings.Format == TextureFormat::Rgba32Float)
+	{
+		threadPool->ParallelFor(height, [&](usize y, usize)
+		{
+			Float4* row = reinterpret_cast<Float4*>(output + y * subresource.RowPitch);
+			for (uint32 x = 0; x < width; ++x)
+			{
+				const Float4& pixel = pixels[y * width + x];
+				row[x] = Float4 { Max(pixel.X, 0.0f), Max(pixel.Y, 0.0f), Max(pixel.Z, 0.0f), Min(Max(pixel.W, 0.0f), 1.0f) };
+			}
+		});
+		return;
+	}
+
+	const bool isSrgb = IsSrgb(settings.Format);
+	const bool isBc7 = settings.Format == TextureFormat::Bc7Unorm || settings.Format == TextureFormat::Bc7SrgbUnorm;
+
+	Array<uint8> rgba(&GlobalAllocator::Get());
+	const usize rgbaPitch = isBc7 ? static_cast<usize>(width) * 4 : subresource.RowPitch;
+	if (isBc7)
+	{
+		rgba.GrowToLengthUninitialized(rgbaPitch * height);
+	}
+	uint8* rgbaData = isBc7 ? rgba.GetData() : output;
+
+	threadPool->ParallelFor(height, [&](usize y, usize)
+	{
+		uint8* row = rgbaData + y * rgbaPitch;
+		for (uint32 x = 0; x < width; ++x)
+		{
+			const Float4& pixel = pixels[y * width + x];
+			row[x * 4 + 0] = ToUnorm8(isSrgb ? LinearToSrgb(Max(pixel.X, 0.0f)) : pixel.X);
+			row[x * 4 + 1] = ToUnorm8(isSrgb ? LinearToSrgb(Max(pixel.Y, 0.0f)) : pixel.Y);
+			row[x * 4 + 2] = ToUnorm8(isSrgb ? LinearToSrgb(Max(pixel.Z, 0.0f)) : pixel.Z);
+			row[x * 4 + 3] = ToUnorm8(pixel.W);
+		}
+	});
+
+	if (isBc7)
+	{
+		EncodeBc7(rgba.GetData(), width, height, settings.Quality, output, subresource.RowPitch, threadPool);
+	}
+}
+
+void Start()
+{
+	CookerSettings settings =
+	{
+		.InputPath = StringView {},
+		.OutputPath = StringView {},
+		.Format = TextureFormat::Bc7SrgbUnorm,
+		.Filter = MipMapFilter::Kaiser,
+		.Quality = Bc7Quality::Normal,
+		.MipMapCount = 0,
+	};
+	if (!ParseSettings(GetCommandLineArguments(), &settings))
+	{
+		LogUsage();
+		return;
+	}
+
+	ThreadPool& threadPool = ThreadPool::Get();
+
+	const double readStart = Platform::GetTime();
+	Array<Float4> pixels(&GlobalAllocator::Get());
+	uint32 width = 0;
+	uint32 height = 0;
+	if (!ReadSourceImage(settings.InputPath, &pixels, &width, &height))
+	{
+		Log("Cooker: failed to read %.*s\n", static_cast<int>(settings.InputPath.GetLength()), settings.InputPath.GetData());
+		return;
+	}
+	Log("Cooker: read a %ux%u image in %.2f ms\n", width, height, (Platform::GetTime() - readStart) * 1000.0);
+
+	const uint32 fullMipMapCount = GetFullMipMapCount(width, height);
+	const DdsDescription description =
+	{
+		.Format = settings.Format,
+		.Width = width,
+		.Height = height,
+		.MipMapCount = settings.MipMapCount == 0 ? fullMipMapCount : Min(settings.MipMapCount, fullMipMapCount),
+		.ArraySize = 1,
+		.IsCubeMap = false,
+	};
+
+	Array<DdsSubresource> subresources(&GlobalAllocator::Get());
+	const usize dataSize = GetDdsSubresources(description, &subresources);
+
+	Array<uint8> data(&GlobalAllocator::Get());
+	data.GrowToLengthUninitialized(dataSize);
+
+	// Each mip is filtered from the one above it, which keeps the cost of the whole chain to a third more than the first step.
+	double filterTime = 0.0;
+	double writeTime = 0.0;
+	Array<Float4> nextPixels(&GlobalAllocator::Get());
+	for (uint32 mipMap = 0; mipMap < description.MipMapCount; ++mipMap)
+	{
+		const DdsSubresource& subresource = subresources[mipMap];
+		if (mipMap != 0)
+		{
+			const DdsSubresource& above = subresources[mipMap - 1];
+
+			const double filterStart = Platform::GetTime();
+			nextPixels.GrowToLengthUninitialized(static_cast<usize>(subresource.Width) * subresource.Height);
+			DownsampleImage(pixels.GetData(), above.Width, above.Height, settings.Filter, nextPixels.GetData(), &threadPool);
+			Array<Float4> previousPixels = Move(pixels);
+			pixels = Move(nextPixels);
+			nextPixels = Move(previousPixels);
+			filterTime += Platform::GetTime() - filterStart;
+		}
+
+		const double writeStart = Platform::GetTime();
+		WriteSubresource(pixels.GetData(), subresource, settings, data.GetData(), &threadPool);
+		writeTime += Platform::GetTime() - writeStart;
+	}
+	Log("Cooker: filtered %u mips in %.2f ms and converted them in %.2f ms on %zu threads\n",
+		description.MipMapCount, filterTime * 1000.0, writeTime * 1000.0, threadPool.GetThreadCount());
+
+	if (!WriteDdsImage(settings.OutputPath, description, data.GetData(), data.GetLength()))
+	{
+		Log("Cooker: failed to write %.*s\n", static_cast<int>(settings.OutputPath.GetLength()), settings.OutputPath.GetData());
+		return;
+	}
+	Log("Cooker: wrote %zu bytes to %.*s\n", data.GetLength(), static_cast<int>(settings.OutputPath.GetLength()), settings.OutputPath.GetData());
+}
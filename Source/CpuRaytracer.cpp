@@ -0,0 +1,423 @@
+#include "CpuRaytracer.hpp"
+#include "BVH.hpp"
+#include "ThreadPool.hpp"
+
+#include <math.h>
+
+// These and the helpers below mirror Trace.hlsl and Common.hlsli, keep them in sync.
+static constexpr uint32 AdaptiveMinSamples = 16;
+static constexpr uint32 AdaptiveMaxSamplesPerFrame = 4;
+
+static constexpr float FieldOfViewYRadians = Pi / 9.0f;
+static constexpr float FocalLength = 1.0f;
+
+static const Vector BackgroundColor = { 0.4f, 0.6f, 0.9f };
+
+static const float Infinity = INFINITY;
+
+struct Hit
+{
+	float Time;
+	Vector Point;
+	Vector Normal;
+	bool FrontFace;
+	Hlsl::Material Material;
+};
+
+static Vector ToVector(Float3 f)
+{
+	return Vector { f.X, f.Y, f.Z };
+}
+
+static Vector Multiply(Vector a, Vector b)
+{
+	return Vector { a.X * b.X, a.Y * b.Y, a.Z * b.Z };
+}
+
+static Vector GetMatrixRow(const Matrix& matrix, usize row)
+{
+	// Trace.hlsl reads the orientation as column-major, so the rows of its transpose are the rows as laid out here.
+	const float* elements = reinterpret_cast<const float*>(&matrix);
+	return Vector { elements[row * 4 + 0], elements[row * 4 + 1], elements[row * 4 + 2] };
+}
+
+static float LinearToSrgb(float x)
+{
+	return x < 0.0031308f ? x * 12.92f : powf(x, 1.0f / 2.4f) * 1.055f - 0.055f;
+}
+
+static Vector Reflect(Vector incoming, Vector normal)
+{
+	return incoming - normal * (2.0f * incoming.Dot(normal));
+}
+
+static Vector Refract(Vector incoming, Vector normal, float refractionIndex)
+{
+	const float cosTheta = Min((-incoming).Dot(normal), 1.0f);
+	const Vector outPerpendicular = (incoming + normal * cosTheta) * refractionIndex;
+	const Vector outParallel = normal * -sqrtf(fabsf(1.0f - outPerpendicular.Dot(outPerpendicular)));
+	return outPerpendicular + outParallel;
+}
+
+static uint32 Hash(uint32 v)
+{
+	v ^= 2747636419u;
+	v *= 2654435769u;
+	v ^= v >> 16;
+	v *= 2654435769u;
+	v ^= v >> 16;
+	v *= 2654435769u;
+	return v;
+}
+
+static uint32 RandomPcg(uint32* rngState)
+{
+	const uint32 state = *rngState;
+	*rngState = *rngState * 747796405u + 2891336453u;
+	const uint32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static float Random01(uint32* rngState)
+{
+	return static_cast<float>(RandomPcg(rngState)) / static_cast<float>(0xFFFFFFFF);
+}
+
+static float Random(uint32* rngState, float min, float max)
+{
+	const float t = Random01(rngState);
+	return min + (max - min) * t;
+}
+
+static Vector RandomUnitVector(uint32* rngState)
+{
+	Vector x;
+	while (true)
+	{
+		x = Vector { Random(rngState, -1.0f, 1.0f), Random(rngState, -1.0f, 1.0f), Random(rngState, -1.0f, 1.0f) };
+		const float lengthSquared = x.Dot(x);
+		if (1e-20f <= lengthSquared && lengthSquared <= 1.0f)
+		{
+			break;
+		}
+	}
+	return x.GetNormalized();
+}
+
+static Hit MakeHit(Vector rayOrigin, Vector rayDirection, float time, const Hlsl::Sphere& sphere)
+{
+	const Vector spherePosition = ToVector(sphere.Position);
+
+	const Vector hitPoint = rayOrigin + rayDirection * time;
+	const Vector outwardNormal = (hitPoint - spherePosition) * (1.0f / sphere.Radius);
+	const bool frontFace = rayDirection.Dot(outwardNormal) <= 0.0f;
+
+	return Hit
+	{
+		.Time = time,
+		.Point = hitPoint,
+		.Normal = frontFace ? outwardNormal : -outwardNormal,
+		.FrontFace = frontFace,
+		.Material = sphere.Material,
+	};
+}
+
+static void Scatter(uint32* rngState, Vector* rayDirection, Vector* attenuation, const Hit& hit)
+{
+	switch (hit.Material.Type)
+	{
+	case Hlsl::MaterialType::Lambertian:
+	{
+		*attenuation = Multiply(*attenuation, ToVector(hit.Material.Albedo));
+		*rayDirection = (hit.Normal + RandomUnitVector(rngState)).GetNormalized();
+		if (isnan(rayDirection->X) || isnan(rayDirection->Y) || isnan(rayDirection->Z))
+		{
+			*rayDirection = hit.Normal;
+		}
+		break;
+	}
+	case Hlsl::MaterialType::Metallic:
+	{
+		*attenuation = Multiply(*attenuation, ToVector(hit.Material.Albedo));
+		*rayDirection = Reflect(*rayDirection, hit.Normal);
+		break;
+	}
+	case Hlsl::MaterialType::Dielectric:
+	{
+		const float index = hit.FrontFace ? (1.0f / hit.Material.RefractionIndex) : hit.Material.RefractionIndex;
+
+		const float cosTheta = Min((-*rayDirection).Dot(hit.Normal), 1.0f);
+		const float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+
+		const float r0 = powf((1.0f - index) / (1.0f + index), 2.0f);
+		const float schlick = r0 + (1.0f - r0) * powf((1.0f - cosTheta), 5.0f);
+
+		const bool cannotRefract = index * sinTheta > 1.0f;
+		if (cannotRefract || schlick > Random01(rngState))
+		{
+			*rayDirection = Reflect(*rayDirection, hit.Normal);
+		}
+		else
+		{
+			*rayDirection = Refract(*rayDirection, hit.Normal, index);
+		}
+		break;
+	}
+	}
+}
+
+CpuScene CreateCpuScene(Array<Hlsl::Sphere>&& spheres, bool useBvh)
+{
+	// Leaves as wide as the SIMD kernel keep its lanes busy without deepening the tree.
+	Array<Hlsl::BvhNode> bvhNodes = useBvh ? BuildBvh(&spheres, SphereSoaWidth) : Array<Hlsl::BvhNode> { &GlobalAllocator::Get() };
+	SphereSoa spheresSoa = BuildSphereSoa(spheres);
+
+	return CpuScene
+	{
+		.Spheres = Move(spheres),
+		.BvhNodes = Move(bvhNodes),
+		.SpheresSoa = Move(spheresSoa),
+	};
+}
+
+CpuRaytracer::CpuRaytracer(uint32 width, uint32 height, ThreadPool* threadPool)
+	: Width(0)
+	, Height(0)
+	, Scheduler(threadPool)
+{
+	CHECK(threadPool);
+	Counters.GrowToLengthUninitialized(threadPool->GetThreadCount());
+	Resize(width, height);
+}
+
+static float Luminance(const Vector& color)
+{
+	return color.X * 0.2126f + color.Y * 0.7152f + color.Z * 0.0722f;
+}
+
+static float RelativeError(const Float4& accumulated, float luminanceSquaredSum)
+{
+	const float count = accumulated.W;
+	const float mean = Luminance(Vector { accumulated.X, accumulated.Y, accumulated.Z }) / count;
+	const float variance = Max(luminanceSquaredSum / count - mean * mean, 0.0f);
+	return sqrtf(variance / count) / Max(mean, 1e-3f);
+}
+
+static uint32 GetAdaptiveSampleCount(const Float4& accumulated, float luminanceSquaredSum, const Hlsl::TraceRootConstants& rootConstants)
+{
+	const float noiseThreshold = rootConstants.NoiseThreshold;
+	if (noiseThreshold <= 0.0f || accumulated.W < static_cast<float>(AdaptiveMinSamples))
+	{
+		return rootConstants.SamplesPerPixel;
+	}
+
+	const float error = RelativeError(accumulated, luminanceSquaredSum);
+	if (error <= noiseThreshold)
+	{
+		return 0;
+	}
+	const uint32 scale = static_cast<uint32>(ceilf(error / noiseThreshold));
+	return rootConstants.SamplesPerPixel * Min(Max(scale, 1u), AdaptiveMaxSamplesPerFrame);
+}
+
+void CpuRaytracer::Resize(uint32 width, uint32 height)
+{
+	Width = width;
+	Height = height;
+
+	Accumulation.Clear();
+	Accumulation.GrowToLengthUninitialized(static_cast<usize>(Width) * Height);
+	Platform::MemorySet(Accumulation.GetData(), 0, Accumulation.GetDataSize());
+
+	LuminanceSquared.Clear();
+	LuminanceSquared.GrowToLengthUninitialized(static_cast<usize>(Width) * Height);
+	Platform::MemorySet(LuminanceSquared.GetData(), 0, LuminanceSquared.GetDataSize());
+}
+
+void CpuRaytracer::Render(const Hlsl::TraceRootConstants& rootConstants, const CpuScene& scene)
+{
+	CHECK(rootConstants.SpheresBufferCount == scene.Spheres.GetLength());
+	CHECK(rootConstants.MaxDepth != 0 && rootConstants.SamplesPerPixel != 0);
+
+	const float aspectRatio = static_cast<float>(Width) / static_cast<float>(Height);
+
+	const float viewportHeight = 2.0f * tanf(FieldOfViewYRadians / 2.0f) * FocalLength;
+	const float viewportWidth = viewportHeight * aspectRatio;
+
+	const Vector cameraX = GetMatrixRow(rootConstants.Orientation, 0);
+	const Vector cameraY = GetMatrixRow(rootConstants.Orientation, 1);
+	const Vector cameraZ = GetMatrixRow(rootConstants.Orientation, 2);
+
+	const Vector viewportX = cameraX * viewportWidth;
+	const Vector viewportY = -cameraY * viewportHeight;
+
+	const Vector viewportDeltaX = viewportX * (1.0f / static_cast<float>(Width));
+	const Vector viewportDeltaY = viewportY * (1.0f / static_cast<float>(Height));
+	const Vector pixelCenter = (viewportDeltaX + viewportDeltaY) * 0.5f;
+
+	const Vector cameraPosition = ToVector(rootConstants.Position);
+	const Vector viewportTopLeft = cameraPosition - (cameraZ * FocalLength) - (viewportX * 0.5f) - (viewportY * 0.5f);
+
+	const Hlsl::Sphere* sphereData = scene.Spheres.GetData();
+	const Hlsl::BvhNode* nodeData = scene.BvhNodes.IsEmpty() ? nullptr : scene.BvhNodes.GetData();
+	const uint32 frameIndex = rootConstants.FrameIndex;
+	const uint32 maxDepth = rootConstants.MaxDepth;
+
+	for (RenderCounters& counters : Counters)
+	{
+		counters = {};
+	}
+
+	const auto tracePixel = [&](uint32 x, uint32 y, RenderCounters* counters)
+	{
+		const uint32 pixelIndex = y * Width + x;
+
+		Float4& accumulated = Accumulation[pixelIndex];
+		float& luminanceSquaredSum = LuminanceSquared[pixelIndex];
+		if (frameIndex == 0)
+		{
+			accumulated = Float4 { 0.0f, 0.0f, 0.0f, 0.0f };
+			luminanceSquaredSum = 0.0f;
+		}
+
+		const uint32 sampleCount = GetAdaptiveSampleCount(accumulated, luminanceSquaredSum, rootConstants);
+		if (sampleCount == 0)
+		{
+			++counters->ConvergedPixels;
+			return;
+		}
+		counters->Samples += sampleCount;
+
+		uint32 rngState = Hash(pixelIndex * frameIndex);
+		RandomPcg(&rngState);
+
+		Vector samples = Vector::Zero;
+		float luminanceSquared = 0.0f;
+		for (uint32 i = 0; i < sampleCount; ++i)
+		{
+			const float sampleOffsetX = Random01(&rngState) - 0.5f;
+			const float sampleOffsetY = Random01(&rngState) - 0.5f;
+			const Vector viewportPixel = viewportTopLeft + pixelCenter +
+										 viewportDeltaX * (static_cast<float>(x) + sampleOffsetX) +
+										 viewportDeltaY * (static_cast<float>(y) + sampleOffsetY);
+
+			Vector rayOrigin = cameraPosition;
+			Vector rayDirection = (viewportPixel - cameraPosition).GetNormalized();
+			uint32 depth = 0;
+
+			Vector color = BackgroundColor;
+			while (depth != maxDepth)
+			{
+				++counters->Rays;
+				const BvhHit closest = nodeData
+									 ? TraverseBvh(nodeData, scene.SpheresSoa, rayOrigin, rayDirection, 0.001f, Infinity)
+									 : TraverseLinear(scene.SpheresSoa, rayOrigin, rayDirection, 0.001f, Infinity);
+
+				if (IsValidHit(closest))
+				{
+					const Hit hit = MakeHit(rayOrigin, rayDirection, closest.Time, sphereData[closest.SphereIndex]);
+					Scatter(&rngState, &rayDirection, &color, hit);
+					rayOrigin = hit.Point;
+
+					++depth;
+				}
+				else
+				{
+					break;
+				}
+			}
+			samples = samples + color;
+			luminanceSquared += Luminance(color) * Luminance(color);
+		}
+
+		accumulated.X += samples.X;
+		accumulated.Y += samples.Y;
+		accumulated.Z += samples.Z;
+		accumulated.W += static_cast<float>(sampleCount);
+		luminanceSquaredSum += luminanceSquared;
+	};
+
+	Scheduler.Run(Width, Height, [&](const Tile& tile, usize threadIndex)
+	{
+		RenderCounters tileCounters = {};
+		for (uint32 y = tile.Y; y < tile.Y + tile.Height; ++y)
+		{
+			for (uint32 x = tile.X; x < tile.X + tile.Width; ++x)
+			{
+				tracePixel(x, y, &tileCounters);
+			}
+		}
+		RenderCounters& counters = Counters[threadIndex];
+		counters.Rays += tileCounters.Rays;
+		counters.Samples += tileCounters.Samples;
+		counters.ConvergedPixels += tileCounters.ConvergedPixels;
+	});
+}
+
+uint64 CpuRaytracer::GetRayCount() const
+{
+	uint64 total = 0;
+	for (const RenderCounters& counters : Counters)
+	{
+		total += counters.Rays;
+	}
+	return total;
+}
+
+uint64 CpuRaytracer::GetSampleCount() const
+{
+	uint64 total = 0;
+	for (const RenderCounters& counters : Counters)
+	{
+		total += counters.Samples;
+	}
+	return total;
+}
+
+usize CpuRaytracer::GetConvergedPixelCount() const
+{
+	usize total = 0;
+	for (const RenderCounters& counters : Counters)
+	{
+		total += counters.ConvergedPixels;
+	}
+	return total;
+}
+
+static Float3 GetAverage(const Float4& accumulated)
+{
+	const float scale = accumulated.W > 0.0f ? 1.0f / accumulated.W : 0.0f;
+	return Float3 { accumulated.X * scale, accumulated.Y * scale, accumulated.Z * scale };
+}
+
+void CpuRaytracer::ResolveLinear(Float3* output) const
+{
+	CHECK(output);
+
+	const usize pixelCount = static_cast<usize>(Width) * Height;
+	for (usize i = 0; i < pixelCount; ++i)
+	{
+		output[i] = GetAverage(Accumulation[i]);
+	}
+}
+
+void CpuRaytracer::ResolveRgba8(uint8* output) const
+{
+	CHECK(output);
+
+	const auto toUnorm = [](float x)
+	{
+		const float clamped = Min(Max(x, 0.0f), 1.0f);
+		return static_cast<uint8>(LinearToSrgb(clamped) * 255.0f + 0.5f);
+	};
+
+	const usize pixelCount = static_cast<usize>(Width) * Height;
+	for (usize i = 0; i < pixelCount; ++i)
+	{
+		const Float3 color = GetAverage(Accumulation[i]);
+		output[i * 4 + 0] = toUnorm(color.X);
+		output[i * 4 + 1] = toUnorm(color.Y);
+		output[i * 4 + 2] = toUnorm(color.Z);
+		output[i * 4 + 3] = 0xFF;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SphereSoa.hpp"
+#include "TileScheduler.hpp"
+#include "Trace.hpp"
+
+#include "Luft/Array.hpp"
+#include "Luft/NoCopy.hpp"
+
+class ThreadPool;
+
+struct CpuScene
+{
+	Array<Hlsl::Sphere> Spheres;
+	Array<Hlsl::BvhNode> BvhNodes;
+	SphereSoa SpheresSoa;
+};
+
+// Without a BVH every sphere is tested for every ray, like the original kernel did.
+CpuScene CreateCpuScene(Array<Hlsl::Sphere>&& spheres, bool useBvh);
+
+class CpuRaytracer : public NoCopy
+{
+public:
+	CpuRaytracer(uint32 width, uint32 height, ThreadPool* threadPool);
+
+	void Render(const Hlsl::TraceRootConstants& rootConstants, const CpuScene& scene);
+
+	void Resize(uint32 width, uint32 height);
+
+	// Both write Width * Height pixels, the average of the accumulated samples.
+	void ResolveLinear(Float3* output) const;
+	void ResolveRgba8(uint8* output) const;
+
+	uint32 GetWidth() const { return Width; }
+	uint32 GetHeight() const { return Height; }
+
+	// Running sum of linear samples in XYZ and the sample count in W, like the GPU accumulation texture.
+	const Array<Float4>& GetAccumulation() const { return Accumulation; }
+
+	const TileScheduler& GetScheduler() const { return Scheduler; }
+
+	// Rays traced by the last call to Render, counting every bounce.
+	uint64 GetRayCount() const;
+
+	// Camera samples taken by the last call to Render, which varies per pixel when a noise threshold is set.
+	uint64 GetSampleCount() const;
+
+	// Pixels skipped by the last call to Render because their estimated noise was below the threshold.
+	usize GetConvergedPixelCount() const;
+
+private:
+	uint32 Width;
+	uint32 Height;
+
+	Array<Float4> Accumulation;
+	Array<float> LuminanceSquared;
+
+	struct alignas(64) RenderCounters
+	{
+		uint64 Rays;
+		uint64 Samples;
+		usize ConvergedPixels;
+	};
+	Array<RenderCounters> Counters;
+
+	TileScheduler Scheduler;
+};
@@ -1,8 +1,8 @@
 ﻿#include "DDS.hpp"
 
-#include <dxgiformat.h>
+#include "Luft/Math.hpp"
 
-static Allocator* DdsAllocator = &GlobalAllocator::Get();
+#include <dxgiformat.h>
 
 struct PixelFormat
 {
@@ -41,7 +41,27 @@ struct DdsExtendedHeader
 };
 
 static constexpr char FormatSignature[] = "DDS ";
-static usize HeadersSize = sizeof(DdsHeader) + sizeof(DdsExtendedHeader) + (sizeof(FormatSignature) - 1);
+static_assert(DdsHeadersSize == sizeof(DdsHeader) + sizeof(DdsExtendedHeader) + (sizeof(FormatSignature) - 1));
+
+static constexpr uint32 HeaderCapsFlag = 0x1;
+static constexpr uint32 HeaderHeightFlag = 0x2;
+static constexpr uint32 HeaderWidthFlag = 0x4;
+static constexpr uint32 HeaderPixelFormatFlag = 0x1000;
+
+static constexpr uint32 PixelFormatCompressedOrCustomFlag = 0x4;
+
+static constexpr uint32 HeaderPitchFlag = 0x8;
+static constexpr uint32 HeaderMipMapCountFlag = 0x20000;
+static constexpr uint32 HeaderLinearSizeFlag = 0x80000;
+
+static constexpr uint32 CapsComplexFlag = 0x8;
+static constexpr uint32 CapsTextureFlag = 0x1000;
+static constexpr uint32 CapsMipMapFlag = 0x400000;
+
+static constexpr uint32 PixelFormatExtendedHeader = 808540228;
+
+static constexpr uint32 ExtendedHeaderRectangleTexture = 3;
+static constexpr uint32 ExtendedHeaderCubeMapFlag = 0x4;
 
 static TextureFormat FromD3D12(DXGI_FORMAT format)
 {
@@ -63,9 +83,212 @@ static TextureFormat FromD3D12(DXGI_FORMAT format)
 		return TextureFormat::Depth24Stencil8;
 	case DXGI_FORMAT_D32_FLOAT:
 		return TextureFormat::Depth32;
+	default:
+		return TextureFormat::None;
+	}
+}
+
+static DXGI_FORMAT ToD3D12(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::Rgba8Unorm:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case TextureFormat::Rgba8SrgbUnorm:
+		return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	case TextureFormat::Rgba32Float:
+		return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case TextureFormat::Bc7Unorm:
+		return DXGI_FORMAT_BC7_UNORM;
+	case TextureFormat::Bc7SrgbUnorm:
+		return DXGI_FORMAT_BC7_UNORM_SRGB;
+	case TextureFormat::Depth24Stencil8:
+		return DXGI_FORMAT_D24_UNORM_S8_UINT;
+	case TextureFormat::Depth32:
+		return DXGI_FORMAT_D32_FLOAT;
+	default:
+		CHECK(false);
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+// How a format packs its pixels into blocks. Uncompressed formats use blocks of one pixel, block-compressed formats 4x4
+// blocks and packed 4:2:2 formats blocks of two pixels that share their chroma.
+struct FormatLayout
+{
+	uint32 BlockWidth;
+	uint32 BlockHeight;
+	uint32 BlockSize;
+};
+
+static FormatLayout GetFormatLayout(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return { 1, 1, 16 };
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return { 1, 1, 12 };
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+		return { 1, 1, 8 };
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+		return { 1, 1, 4 };
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+	case DXGI_FORMAT_A8P8:
+		return { 1, 1, 2 };
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return { 1, 1, 1 };
+	case DXGI_FORMAT_R1_UNORM:
+		return { 8, 1, 1 };
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_YUY2:
+		return { 2, 1, 4 };
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return { 2, 1, 8 };
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return { 4, 4, 8 };
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return { 4, 4, 16 };
+	default:
+		// Planar video formats store their chroma in a second plane with a layout of its own.
+		VERIFY(false, "Unsupported DDS pixel format!");
+		return {};
 	}
-	CHECK(false);
-	return TextureFormat::None;
+}
+
+static DdsSubresource GetSubresourceLayout(const FormatLayout& layout, uint32 width, uint32 height, usize offset)
+{
+	const usize blocksWide = (width + layout.BlockWidth - 1) / layout.BlockWidth;
+	const uint32 rowCount = (height + layout.BlockHeight - 1) / layout.BlockHeight;
+	const usize rowPitch = blocksWide * layout.BlockSize;
+
+	return DdsSubresource
+	{
+		.Offset = offset,
+		.RowPitch = rowPitch,
+		.SlicePitch = rowPitch * rowCount,
+		.Width = width,
+		.Height = height,
+		.RowCount = rowCount,
+	};
+}
+
+static usize GetSubresources(const FormatLayout& layout, uint32 width, uint32 height, uint32 mipMapCount, uint32 arraySize,
+							 Array<DdsSubresource>* subresources)
+{
+	CHECK(subresources);
+
+	usize offset = 0;
+	for (uint32 arrayLayer = 0; arrayLayer < arraySize; ++arrayLayer)
+	{
+		for (uint32 mipMap = 0; mipMap < mipMapCount; ++mipMap)
+		{
+			const uint32 mipWidth = Max(width >> mipMap, 1u);
+			const uint32 mipHeight = Max(height >> mipMap, 1u);
+			const DdsSubresource subresource = GetSubresourceLayout(layout, mipWidth, mipHeight, offset);
+
+			offset += subresource.SlicePitch;
+			subresources->Add(subresource);
+		}
+	}
+	return offset;
 }
 
 static int32 Advance(usize* offset, usize count)
@@ -81,10 +304,11 @@ static uint32 ParseUint32(StringView view, usize* offset)
 	const usize currentOffset = *offset;
 	VERIFY(currentOffset + sizeof(uint32) <= view.GetLength(), "Failed to parse integer!");
 
-	const uint32 value = (view[currentOffset + 0] << 0)  |
-						 (view[currentOffset + 1] << 8)  |
-						 (view[currentOffset + 2] << 16) |
-						 (view[currentOffset + 3] << 24);
+	// The bytes are widened unsigned, a char above 0x7F would otherwise sign-extend over the bytes above it.
+	const uint32 value = (static_cast<uint32>(static_cast<uint8>(view[currentOffset + 0])) << 0)  |
+						 (static_cast<uint32>(static_cast<uint8>(view[currentOffset + 1])) << 8)  |
+						 (static_cast<uint32>(static_cast<uint8>(view[currentOffset + 2])) << 16) |
+						 (static_cast<uint32>(static_cast<uint8>(view[currentOffset + 3])) << 24);
 
 	*offset += sizeof(uint32);
 	return value;
@@ -92,26 +316,32 @@ static uint32 ParseUint32(StringView view, usize* offset)
 
 static int32 ParseInt32(StringView view, usize* offset)
 {
-	CHECK(offset);
-	const usize currentOffset = *offset;
-	VERIFY(currentOffset + sizeof(uint32) <= view.GetLength(), "Failed to parse integer!");
-
-	const int32 value = (view[currentOffset + 0] << 0)  |
-						(view[currentOffset + 1] << 8)  |
-						(view[currentOffset + 2] << 16) |
-						(view[currentOffset + 3] << 24);
+	return static_cast<int32>(ParseUint32(view, offset));
+}
 
-	*offset += sizeof(uint32);
-	return value;
+uint32 GetFullMipMapCount(uint32 width, uint32 height)
+{
+	uint32 mipMapCount = 1;
+	while ((Max(width, height) >> mipMapCount) != 0)
+	{
+		++mipMapCount;
+	}
+	return mipMapCount;
 }
 
-DdsImage LoadDdsImage(StringView filePath)
+usize GetDdsSubresources(const DdsDescription& description, Array<DdsSubresource>* subresources)
 {
-	usize ddsFileSize;
-	char* ddsFileData = reinterpret_cast<char*>(Platform::ReadEntireFile(filePath.GetData(), filePath.GetLength(), &ddsFileSize, *DdsAllocator));
-	const StringView ddsFileView = { ddsFileData, ddsFileSize };
+	CHECK(description.Width != 0 && description.Height != 0);
+	CHECK(description.MipMapCount != 0 && description.MipMapCount <= GetFullMipMapCount(description.Width, description.Height));
+	CHECK(description.ArraySize != 0 && (!description.IsCubeMap || description.ArraySize % 6 == 0));
 
-	VERIFY(ddsFileSize >= sizeof(FormatSignature) - 1, "Invalid DDS file!");
+	const FormatLayout layout = GetFormatLayout(ToD3D12(description.Format));
+	return GetSubresources(layout, description.Width, description.Height, description.MipMapCount, description.ArraySize, subresources);
+}
+
+DdsImage ParseDdsHeaders(StringView ddsFileView, usize fileSize)
+{
+	VERIFY(ddsFileView.GetLength() >= DdsHeadersSize && fileSize >= DdsHeadersSize, "Invalid DDS file!");
 	for (usize i = 0; i < sizeof(FormatSignature) - 1; ++i)
 	{
 		VERIFY(ddsFileView[i] == FormatSignature[i], "Unexpected image file format!");
@@ -154,28 +384,17 @@ DdsImage LoadDdsImage(StringView filePath)
 		Platform::Log("LoadDdsImage: Flipped-Y is currently unsupported!\n");
 	}
 
-	static constexpr uint32 headerCapsFlag = 0x1;
-	static constexpr uint32 headerHeightFlag = 0x2;
-	static constexpr uint32 headerWidthFlag = 0x4;
-	static constexpr uint32 headerPixelFormatFlag = 0x1000;
-
-	static constexpr uint32 pixelFormatCompressedOrCustomFlag = 0x4;
-
-	static constexpr uint32 capsTextureFlag = 0x1000;
-
-	static constexpr uint32 pixelFormatExtendedHeader = 808540228;
-
 	VERIFY(header.Size == 124, "Invalid DDS file!");
-	VERIFY(header.Flags & headerCapsFlag, "Invalid DDS file!");
-	VERIFY(header.Flags & headerHeightFlag, "Invalid DDS file!");
-	VERIFY(header.Flags & headerWidthFlag, "Invalid DDS file!");
-	VERIFY(header.Flags & headerPixelFormatFlag, "Invalid DDS file!");
+	VERIFY(header.Flags & HeaderCapsFlag, "Invalid DDS file!");
+	VERIFY(header.Flags & HeaderHeightFlag, "Invalid DDS file!");
+	VERIFY(header.Flags & HeaderWidthFlag, "Invalid DDS file!");
+	VERIFY(header.Flags & HeaderPixelFormatFlag, "Invalid DDS file!");
 
-	VERIFY(header.Caps[0] & capsTextureFlag, "Invalid DDS file!");
+	VERIFY(header.Caps[0] & CapsTextureFlag, "Invalid DDS file!");
 
 	VERIFY(header.Format.Size == 32, "Invalid DDS file!");
-	VERIFY(header.Format.Flags & pixelFormatCompressedOrCustomFlag, "Unexpected DDS file type!");
-	VERIFY(header.Format.CompressedOrCustomFormat == pixelFormatExtendedHeader, "Unexpected DDS file type!");
+	VERIFY(header.Format.Flags & PixelFormatCompressedOrCustomFlag, "Unexpected DDS file type!");
+	VERIFY(header.Format.CompressedOrCustomFormat == PixelFormatExtendedHeader, "Unexpected DDS file type!");
 
 	const DdsExtendedHeader extendedHeader =
 	{
@@ -186,30 +405,148 @@ DdsImage LoadDdsImage(StringView filePath)
 		.MiscFlags2 = ParseUint32(ddsFileView, &offset),
 	};
 
-	static constexpr usize extendedHeaderRectangleTexture = 3;
+	VERIFY(extendedHeader.ResourceDimension == ExtendedHeaderRectangleTexture, "Unexpected DDS file type!");
+	VERIFY(extendedHeader.ArraySize != 0, "Invalid DDS file!");
+	VERIFY(header.Width > 0 && header.Height > 0, "Invalid DDS file!");
 
-	VERIFY(extendedHeader.ResourceDimension == extendedHeaderRectangleTexture, "Unexpected DDS file type!");
-	VERIFY(extendedHeader.ArraySize == 1, "Unexpected DDS file type!");
+	const uint32 width = static_cast<uint32>(header.Width);
+	const uint32 height = static_cast<uint32>(header.Height);
 
-	uint8* imageData = reinterpret_cast<uint8*>(ddsFileData + HeadersSize);
-	const usize imageDataSize = ddsFileSize - HeadersSize;
+	// Writers that leave out the mip map count mean a single level.
+	const bool hasMipMapCount = (header.Flags & HeaderMipMapCountFlag) && header.MipMapCount > 0;
+	const uint32 mipMapCount = hasMipMapCount ? static_cast<uint32>(header.MipMapCount) : 1;
+
+	VERIFY(mipMapCount <= GetFullMipMapCount(width, height), "Invalid DDS file!");
+
+	const bool isCubeMap = extendedHeader.MiscFlags1 & ExtendedHeaderCubeMapFlag;
+	const uint32 arraySize = extendedHeader.ArraySize * (isCubeMap ? 6 : 1);
+
+	const FormatLayout layout = GetFormatLayout(extendedHeader.DxgiFormat);
+	const usize imageDataSize = fileSize - DdsHeadersSize;
+
+	Array<DdsSubresource> subresources(&GlobalAllocator::Get());
+	const usize subresourcesSize = GetSubresources(layout, width, height, mipMapCount, arraySize, &subresources);
+	VERIFY(subresourcesSize <= imageDataSize, "DDS file is truncated!");
+
+	// Many writers get the pitch wrong, so it is only checked against the size worked out from the format.
+	const DdsSubresource& top = subresources[0];
+	const usize expectedPitch = (header.Flags & HeaderLinearSizeFlag) ? top.SlicePitch : top.RowPitch;
+	const bool hasPitch = (header.Flags & (HeaderPitchFlag | HeaderLinearSizeFlag)) && header.PitchOrLinearSize != 0;
+	if (hasPitch && static_cast<usize>(header.PitchOrLinearSize) != expectedPitch)
+	{
+		Platform::Log("LoadDdsImage: Ignoring a pitch that does not match the pixel format!\n");
+	}
 
 	return DdsImage
 	{
-		.Data = imageData,
+		.File = {},
+		.Data = nullptr,
 		.DataSize = imageDataSize,
 		.Format = FromD3D12(extendedHeader.DxgiFormat),
-		.Width = static_cast<uint32>(header.Width),
-		.Height = static_cast<uint32>(header.Height),
-		.MipMapCount = static_cast<uint32>(header.MipMapCount),
+		.Width = width,
+		.Height = height,
+		.MipMapCount = mipMapCount,
+		.ArraySize = arraySize,
+		.IsCubeMap = isCubeMap,
+		.Subresources = Move(subresources),
 	};
 }
 
+DdsImage LoadDdsImage(StringView filePath)
+{
+	MappedFile ddsFile(filePath);
+
+	DdsImage image = ParseDdsHeaders(ddsFile.GetView(), ddsFile.GetSize());
+	image.Data = ddsFile.GetData() + DdsHeadersSize;
+	image.File = Move(ddsFile);
+	return image;
+}
+
 void UnloadDdsImage(DdsImage* image)
 {
-	DdsAllocator->Deallocate(image->Data - HeadersSize, image->DataSize + HeadersSize);
+	image->File.Close();
 	image->Data = nullptr;
 	image->DataSize = 0;
 	image->Width = 0;
 	image->Height = 0;
+	image->MipMapCount = 0;
+	image->ArraySize = 0;
+	image->Subresources.Clear();
+}
+
+bool WriteDdsImage(StringView filePath, const DdsDescription& description, const uint8* data, usize dataSize)
+{
+	CHECK(data);
+
+	Array<DdsSubresource> subresources(&GlobalAllocator::Get());
+	VERIFY(GetDdsSubresources(description, &subresources) == dataSize, "DDS image data does not match its description!");
+
+	const DXGI_FORMAT dxgiFormat = ToD3D12(description.Format);
+	const FormatLayout layout = GetFormatLayout(dxgiFormat);
+
+	// Block-compressed formats give the size of the whole top mip, the others the size of one of its rows.
+	const bool isCompressed = layout.BlockWidth == 4 && layout.BlockHeight == 4;
+	const DdsSubresource& top = subresources[0];
+
+	const bool hasMipMaps = description.MipMapCount > 1;
+	const bool isComplex = hasMipMaps || description.ArraySize > 1;
+
+	const DdsHeader header =
+	{
+		.Size = sizeof(DdsHeader),
+		.Flags = static_cast<int32>(HeaderCapsFlag | HeaderHeightFlag | HeaderWidthFlag | HeaderPixelFormatFlag |
+									(isCompressed ? HeaderLinearSizeFlag : HeaderPitchFlag) |
+									(hasMipMaps ? HeaderMipMapCountFlag : 0)),
+		.Height = static_cast<int32>(description.Height),
+		.Width = static_cast<int32>(description.Width),
+		.PitchOrLinearSize = static_cast<int32>(isCompressed ? top.SlicePitch : top.RowPitch),
+		.Depth = 0,
+		.MipMapCount = static_cast<int32>(description.MipMapCount),
+		.Reserved1 = {},
+		.Format =
+		{
+			.Size = sizeof(PixelFormat),
+			.Flags = static_cast<int32>(PixelFormatCompressedOrCustomFlag),
+			.CompressedOrCustomFormat = static_cast<int32>(PixelFormatExtendedHeader),
+			.RgbBitCount = 0,
+			.RedBitMask = 0,
+			.GreenBitMask = 0,
+			.BlueBitMask = 0,
+			.AlphaBitMask = 0,
+		},
+		.Caps =
+		{
+			static_cast<int32>(CapsTextureFlag | (isComplex ? CapsComplexFlag : 0) | (hasMipMaps ? CapsMipMapFlag : 0)),
+			0,
+			0,
+			0,
+		},
+		.Reserved2 = 0,
+	};
+
+	// Cube maps count cubes rather than faces.
+	const DdsExtendedHeader extendedHeader =
+	{
+		.DxgiFormat = dxgiFormat,
+		.ResourceDimension = ExtendedHeaderRectangleTexture,
+		.MiscFlags1 = description.IsCubeMap ? ExtendedHeaderCubeMapFlag : 0,
+		.ArraySize = description.IsCubeMap ? description.ArraySize / 6 : description.ArraySize,
+		.MiscFlags2 = 0,
+	};
+
+	static_assert(sizeof(DdsHeader) == 124 && sizeof(DdsExtendedHeader) == 20);
+
+	Array<uint8> file(&GlobalAllocator::Get());
+	file.GrowToLengthUninitialized(DdsHeadersSize + dataSize);
+
+	uint8* output = file.GetData();
+	Platform::MemoryCopy(output, FormatSignature, sizeof(FormatSignature) - 1);
+	output += sizeof(FormatSignature) - 1;
+	Platform::MemoryCopy(output, &header, sizeof(header));
+	output += sizeof(header);
+	Platform::MemoryCopy(output, &extendedHeader, sizeof(extendedHeader));
+	output += sizeof(extendedHeader);
+	Platform::MemoryCopy(output, data, dataSize);
+
+	return WriteEntireFile(filePath, file.GetData(), file.GetLength());
 }
@@ -1,13 +1,36 @@
 ﻿#pragma once
 
+#include "File.hpp"
+
 #include "RHI/Texture.hpp"
 
+#include "Luft/Array.hpp"
 #include "Luft/Base.hpp"
 #include "Luft/String.hpp"
 
+// Where the pixels start in a DDS file. Only files with the DX10 extended header are read or written.
+static constexpr usize DdsHeadersSize = 148;
+
+// Where one mip level of one array layer lives in DdsImage::Data. Pitches are counted in rows of blocks, which are rows of
+// pixels for uncompressed formats and rows of four pixels for block-compressed ones.
+struct DdsSubresource
+{
+	usize Offset;
+	usize RowPitch;
+	usize SlicePitch;
+
+	uint32 Width;
+	uint32 Height;
+	uint32 RowCount;
+};
+
+// The pixels are a view into the mapped file, so they stay valid until the image is unloaded. Format is None for formats
+// the RHI has no equivalent of, the subresources are described either way.
 struct DdsImage
 {
-	uint8* Data;
+	MappedFile File;
+
+	const uint8* Data;
 	usize DataSize;
 
 	TextureFormat Format;
@@ -16,7 +39,48 @@ struct DdsImage
 	uint32 Height;
 
 	uint32 MipMapCount;
+
+	// Six layers for each cube in a cube map.
+	uint32 ArraySize;
+	bool IsCubeMap;
+
+	// In the order they are stored, which is the D3D12 subresource order: every mip of the first layer, then the next layer.
+	Array<DdsSubresource> Subresources;
+
+	const DdsSubresource& GetSubresource(uint32 mipMap, uint32 arrayLayer) const
+	{
+		CHECK(mipMap < MipMapCount && arrayLayer < ArraySize);
+		return Subresources[arrayLayer * MipMapCount + mipMap];
+	}
+};
+
+// An image to be written, with its subresources laid out the same way LoadDdsImage finds them.
+struct DdsDescription
+{
+	TextureFormat Format;
+
+	uint32 Width;
+	uint32 Height;
+
+	uint32 MipMapCount;
+
+	// Six layers for each cube in a cube map.
+	uint32 ArraySize;
+	bool IsCubeMap;
 };
 
+// The number of mips down to and including 1x1.
+uint32 GetFullMipMapCount(uint32 width, uint32 height);
+
+// Adds the subresources of the description in the order they are stored and returns the size they take up together.
+usize GetDdsSubresources(const DdsDescription& description, Array<DdsSubresource>* subresources);
+
 DdsImage LoadDdsImage(StringView filePath);
+
+// Parses the first DdsHeadersSize bytes of a DDS file, for loaders that read the pixels themselves. The image has no file and
+// no data, its subresource offsets count from DdsHeadersSize.
+DdsImage ParseDdsHeaders(StringView headers, usize fileSize);
 void UnloadDdsImage(DdsImage* image);
+
+// Data holds every subresource, packed as GetDdsSubresources lays them out. The file always has the DX10 extended header.
+bool WriteDdsImage(StringView filePath, const DdsDescription& description, const uint8* data, usize dataSize);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "Luft/String.hpp"
+
+// Parses a JSON number at the index and advances past it. The result is the correctly rounded double: integers and short
+// decimals take exact double arithmetic, up to 19 significant digits use the Eisel-Lemire algorithm, and longer numbers are
+// handed to strtod.
+double ParseDecimal(StringView buffer, usize* index);
@@ -1,104 +1,391 @@
 #include "DrawText.hpp"
 #include "DDS.hpp"
 #include "JSON.hpp"
+#include "TextureStreamer.hpp"
 
-static constexpr usize MaxCharactersPerFrame = 2048;
+#include <string.h>
 
-DrawText::DrawText()
-	: Glyphs(64)
-	, Ascender(0.0f)
-	, RootConstants()
-	, CharacterIndex(0)
-	, Device(nullptr)
+static constexpr usize InitialCharacterCapacity = 2048;
+
+// The RHI only writes whole buffers, so the characters go to the GPU in buffers of this many, one draw each. A frame
+// uploads the chunks it draws from, which is less than a chunk more than it drew.
+static constexpr usize CharacterChunkSize = 256;
+
+// The last chunk of a frame is uploaded whole, so the frame's characters always end on a chunk.
+static_assert(InitialCharacterCapacity % CharacterChunkSize == 0, "Characters must be whole chunks!");
+
+static constexpr uint32 ReplacementCharacter = 0xFFFD;
+
+// The atlas is the only texture streamed, and all of it fits.
+static constexpr usize FontTextureBudget = 64 * 1024 * 1024;
+
+struct DrawText::CachedTextRun
 {
+	Array<char> Text;
+	Float2 Position;
+	Float4 Color;
+	float Scale;
+	float MaxWidth;
+
+	Array<Hlsl::Character> Characters;
+	usize CharacterCount;
+};
+
+static Buffer CreateCharacterBuffer(GpuDevice* device)
+{
+	return device->CreateBuffer("Character Buffer"_view,
+	{
+		.Type = BufferType::StructuredBuffer,
+		.Usage = BufferUsage::Stream,
+		.Size = CharacterChunkSize * sizeof(Hlsl::Character),
+		.Stride = sizeof(Hlsl::Character),
+	});
 }
 
-void DrawText::Init(GpuDevice* device)
+struct GlyphBounds
 {
-	Device = device;
+	double Left;
+	double Bottom;
+	double Right;
+	double Top;
+};
 
-	DdsImage fontImage = LoadDdsImage("Assets/Fonts/RobotoMSDF.dds"_view);
+static GlyphBounds ReadGlyphBounds(JsonCursor* cursor)
+{
+	GlyphBounds bounds = {};
 
-	const JsonObject fontDescription = LoadJson("Assets/Fonts/RobotoMSDF.json"_view);
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "left"_view)
+		{
+			bounds.Left = cursor->ReadDecimal();
+		}
+		else if (key == "bottom"_view)
+		{
+			bounds.Bottom = cursor->ReadDecimal();
+		}
+		else if (key == "right"_view)
+		{
+			bounds.Right = cursor->ReadDecimal();
+		}
+		else if (key == "top"_view)
+		{
+			bounds.Top = cursor->ReadDecimal();
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
+	}
+	return bounds;
+}
 
-	const JsonObject& fontAtlasDescription = fontDescription["atlas"_view].GetObject();
+// Malformed sequences decode to the replacement character, consuming the longest prefix that could have started a valid
+// sequence, so the next character is never swallowed.
+static uint32 DecodeUtf8(StringView text, usize* index)
+{
+	const uint8 lead = static_cast<uint8>(text[*index]);
+	*index += 1;
+	if (lead < 0x80)
+	{
+		return lead;
+	}
 
-	const double distanceRange = fontAtlasDescription["distanceRange"_view].GetDecimal();
-	const uint32 width = static_cast<uint32>(fontAtlasDescription["width"_view].GetDecimal());
-	const uint32 height = static_cast<uint32>(fontAtlasDescription["height"_view].GetDecimal());
+	// Overlong encodings, surrogates and codepoints past U+10FFFF are ruled out by the range of the second byte.
+	uint32 continuationCount;
+	uint32 codepoint;
+	uint8 low = 0x80;
+	uint8 high = 0xBF;
+	if (lead >= 0xC2 && lead <= 0xDF)
+	{
+		continuationCount = 1;
+		codepoint = lead & 0x1F;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF)
+	{
+		continuationCount = 2;
+		codepoint = lead & 0x0F;
+		low = (lead == 0xE0) ? 0xA0 : 0x80;
+		high = (lead == 0xED) ? 0x9F : 0xBF;
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4)
+	{
+		continuationCount = 3;
+		codepoint = lead & 0x07;
+		low = (lead == 0xF0) ? 0x90 : 0x80;
+		high = (lead == 0xF4) ? 0x8F : 0xBF;
+	}
+	else
+	{
+		return ReplacementCharacter;
+	}
 
-	const JsonObject& fontMetrics = fontDescription["metrics"_view].GetObject();
-	Ascender = static_cast<float>(fontMetrics["ascender"_view].GetDecimal());
+	for (uint32 i = 0; i < continuationCount; ++i)
+	{
+		if (*index >= text.GetLength())
+		{
+			return ReplacementCharacter;
+		}
+		const uint8 continuation = static_cast<uint8>(text[*index]);
+		if (continuation < low || continuation > high)
+		{
+			return ReplacementCharacter;
+		}
+		codepoint = (codepoint << 6) | (continuation & 0x3F);
+		*index += 1;
 
-	RootConstants.UnitRange.X = static_cast<float>(distanceRange / width);
-	RootConstants.UnitRange.Y = static_cast<float>(distanceRange / height);
+		low = 0x80;
+		high = 0xBF;
+	}
+	return codepoint;
+}
 
-	const JsonArray& fontGlyphs = fontDescription["glyphs"_view].GetArray();
+DrawText::DrawText()
+	: Ascender(0.0f)
+	, LineHeight(0.0f)
+	, RootConstants()
+	, CharacterIndex(0)
+	, Statistics()
+	, Textures(nullptr)
+	, FontAtlas(0)
+	, FontMipMap(TextureStreamer::NotResident)
+	, FontAtlasData(nullptr)
+	, FontAtlasSize(0)
+	, IsFontTextureRetired()
+	, Device(nullptr)
+{
+}
 
-	for (const JsonValue& glyphValue : fontGlyphs)
+void DrawText::ReadGlyph(JsonCursor* cursor, uint32 atlasWidth, uint32 atlasHeight)
+{
+	uint32 codepoint = 0;
+	float advance = 0.0f;
+	Float2 atlasPosition = { 0.0f, 0.0f };
+	Float2 atlasSize = { 0.0f, 0.0f };
+	Float2 planePosition = { 0.0f, 0.0f };
+	Float2 planeSize = { 0.0f, 0.0f };
+
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
 	{
-		const JsonObject& glyphObject = glyphValue.GetObject();
+		if (key == "unicode"_view)
+		{
+			codepoint = static_cast<uint32>(cursor->ReadDecimal());
+		}
+		else if (key == "advance"_view)
+		{
+			advance = static_cast<float>(cursor->ReadDecimal());
+		}
+		else if (key == "atlasBounds"_view)
+		{
+			const GlyphBounds atlasBounds = ReadGlyphBounds(cursor);
 
-		const float advance = static_cast<float>(glyphObject["advance"_view].GetDecimal());
-		Float2 atlasPosition = { 0.0f, 0.0f };
-		Float2 atlasSize = { 0.0f, 0.0f };
-		Float2 planePosition = { 0.0f, 0.0f };
-		Float2 planeSize = { 0.0f, 0.0f };
+			atlasPosition.X = static_cast<float>(atlasBounds.Left) / static_cast<float>(atlasWidth);
+			atlasPosition.Y = static_cast<float>(atlasBounds.Top) / static_cast<float>(atlasHeight);
 
-		if (glyphObject.HasKey("atlasBounds"_view))
+			atlasSize.X = static_cast<float>(atlasBounds.Right - atlasBounds.Left) / static_cast<float>(atlasWidth);
+			atlasSize.Y = static_cast<float>(atlasBounds.Bottom - atlasBounds.Top) / static_cast<float>(atlasHeight);
+		}
+		else if (key == "planeBounds"_view)
 		{
-			const JsonObject& atlasBounds = glyphObject["atlasBounds"_view].GetObject();
+			const GlyphBounds planeBounds = ReadGlyphBounds(cursor);
 
-			const double left = atlasBounds["left"_view].GetDecimal();
-			const double bottom = atlasBounds["bottom"_view].GetDecimal();
-			const double right = atlasBounds["right"_view].GetDecimal();
-			const double top = atlasBounds["top"_view].GetDecimal();
+			planePosition.X = static_cast<float>(planeBounds.Left);
+			planePosition.Y = static_cast<float>(planeBounds.Top);
 
-			atlasPosition.X = static_cast<float>(left) / static_cast<float>(fontImage.Width);
-			atlasPosition.Y = static_cast<float>(top) / static_cast<float>(fontImage.Height);
-
-			atlasSize.X = static_cast<float>(right - left) / static_cast<float>(fontImage.Width);
-			atlasSize.Y = static_cast<float>(bottom - top) / static_cast<float>(fontImage.Height);
+			planeSize.X = static_cast<float>(planeBounds.Right - planeBounds.Left);
+			planeSize.Y = static_cast<float>(planeBounds.Bottom - planeBounds.Top);
 		}
-
-		if (glyphObject.HasKey("planeBounds"_view))
+		else
 		{
-			const JsonObject& planeBounds = glyphObject["planeBounds"_view].GetObject();
+			cursor->SkipValue();
+		}
+	}
 
-			const double left = planeBounds["left"_view].GetDecimal();
-			const double bottom = planeBounds["bottom"_view].GetDecimal();
-			const double right = planeBounds["right"_view].GetDecimal();
-			const double top = planeBounds["top"_view].GetDecimal();
+	Glyphs.Add(codepoint, Glyph
+	{
+		.AtlasPosition = atlasPosition,
+		.AtlasSize = atlasSize,
+		.PlanePosition = planePosition,
+		.PlaneSize = planeSize,
+		.Advance = advance,
+	});
+}
 
-			planePosition.X = static_cast<float>(left);
-			planePosition.Y = static_cast<float>(top);
+void DrawText::ReadKerningPair(JsonCursor* cursor)
+{
+	uint32 first = 0;
+	uint32 second = 0;
+	float advance = 0.0f;
 
-			planeSize.X = static_cast<float>(right - left);
-			planeSize.Y = static_cast<float>(bottom - top);
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "unicode1"_view)
+		{
+			first = static_cast<uint32>(cursor->ReadDecimal());
 		}
-
-		const char codepoint = static_cast<char>(glyphObject["unicode"_view].GetDecimal());
-		Glyphs.Add(codepoint, Glyph
+		else if (key == "unicode2"_view)
+		{
+			second = static_cast<uint32>(cursor->ReadDecimal());
+		}
+		else if (key == "advance"_view)
 		{
-			.AtlasPosition = atlasPosition,
-			.AtlasSize = atlasSize,
-			.PlanePosition = planePosition,
-			.PlaneSize = planeSize,
-			.Advance = advance,
-		});
+			advance = static_cast<float>(cursor->ReadDecimal());
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
 	}
 
+	Kerning.Add(first, second, advance);
+}
+
+// The RHI only writes whole textures, so the mips read so far are kept until the largest is in, for each larger texture.
+void DrawText::GatherFontAtlas(const DdsImage& image, uint32 mipMap, const uint8* data)
+{
+	VERIFY(image.ArraySize == 1 && !image.IsCubeMap, "Font atlas must be a single texture!");
+
+	if (!FontAtlasData)
+	{
+		const DdsSubresource& last = image.GetSubresource(image.MipMapCount - 1, 0);
+		FontAtlasSize = last.Offset + last.SlicePitch;
+		FontAtlasData = static_cast<uint8*>(GlobalAllocator::Get().Allocate(FontAtlasSize));
+	}
+	const DdsSubresource& subresource = image.GetSubresource(mipMap, 0);
+	Platform::MemoryCopy(FontAtlasData + subresource.Offset, data, subresource.SlicePitch);
+}
+
+void DrawText::RaiseFontTexture(uint32 mipMap)
+{
+	const DdsImage& image = Textures->GetImage(FontAtlas);
+
+	if (FontMipMap != TextureStreamer::NotResident)
+	{
+		const uint32 frameIndex = Device->GetFrameIndex();
+		CHECK(!IsFontTextureRetired[frameIndex]);
+		RetiredFontTextures[frameIndex] = FontTexture;
+		IsFontTextureRetired[frameIndex] = true;
+	}
+
+	// The mips from this one to the smallest follow each other in the gathered atlas, as they do in a texture that starts
+	// at this one.
 	FontTexture = Device->CreateTexture("Font"_view, BarrierLayout::GraphicsQueueCommon,
 	{
-		.Width = fontImage.Width,
-		.Height = fontImage.Height,
+		.Width = Max(image.Width >> mipMap, 1u),
+		.Height = Max(image.Height >> mipMap, 1u),
 		.Type = TextureType::Rectangle,
-		.Format = fontImage.Format,
-		.MipMapCount = fontImage.MipMapCount,
+		.Format = image.Format,
+		.MipMapCount = image.MipMapCount - mipMap,
 	});
-	Device->Write(FontTexture, fontImage.Data);
+	Device->Write(FontTexture, FontAtlasData + image.GetSubresource(mipMap, 0).Offset);
+	FontMipMap = mipMap;
 
-	UnloadDdsImage(&fontImage);
+	if (mipMap == 0)
+	{
+		GlobalAllocator::Get().Deallocate(FontAtlasData, FontAtlasSize);
+		FontAtlasData = nullptr;
+		FontAtlasSize = 0;
+	}
+}
+
+void DrawText::Init(GpuDevice* device)
+{
+	Device = device;
+
+	Textures = GlobalAllocator::Get().Create<TextureStreamer>(FontTextureBudget);
+	FontAtlas = Textures->Request("Assets/Fonts/RobotoMSDF.dds"_view);
+
+	const StringView fontDescriptionPath = "Assets/Fonts/RobotoMSDF.json"_view;
+
+	const JsonTapeFile fontFile(fontDescriptionPath);
+
+	double distanceRange = 0.0;
+	uint32 width = 0;
+	uint32 height = 0;
+
+	JsonCursor cursor = fontFile.GetCursor();
+	cursor.BeginObject();
+	StringView key;
+	while (cursor.NextMember(&key))
+	{
+		if (key == "atlas"_view)
+		{
+			cursor.BeginObject();
+			while (cursor.NextMember(&key))
+			{
+				if (key == "distanceRange"_view)
+				{
+					distanceRange = cursor.ReadDecimal();
+				}
+				else if (key == "width"_view)
+				{
+					width = static_cast<uint32>(cursor.ReadDecimal());
+				}
+				else if (key == "height"_view)
+				{
+					height = static_cast<uint32>(cursor.ReadDecimal());
+				}
+				else
+				{
+					cursor.SkipValue();
+				}
+			}
+		}
+		else if (key == "metrics"_view)
+		{
+			cursor.BeginObject();
+			while (cursor.NextMember(&key))
+			{
+				if (key == "ascender"_view)
+				{
+					Ascender = static_cast<float>(cursor.ReadDecimal());
+				}
+				else if (key == "lineHeight"_view)
+				{
+					LineHeight = static_cast<float>(cursor.ReadDecimal());
+				}
+				else
+				{
+					cursor.SkipValue();
+				}
+			}
+		}
+		else if (key == "glyphs"_view)
+		{
+			// The atlas is still streaming in, so glyphs are placed in it by the size the description gives.
+			VERIFY(width != 0 && height != 0, "Font description must give its atlas size before its glyphs!");
+			cursor.BeginArray();
+			while (cursor.NextElement())
+			{
+				ReadGlyph(&cursor, width, height);
+			}
+		}
+		else if (key == "kerning"_view)
+		{
+			cursor.BeginArray();
+			while (cursor.NextElement())
+			{
+				ReadKerningPair(&cursor);
+			}
+		}
+		else
+		{
+			cursor.SkipValue();
+		}
+	}
+
+	Glyphs.Build();
+	Kerning.Build();
+
+	VERIFY(width != 0 && height != 0, "Font description is missing its atlas size!");
+	RootConstants.UnitRange.X = static_cast<float>(distanceRange / width);
+	RootConstants.UnitRange.Y = static_cast<float>(distanceRange / height);
 
 	Shader vertex = Device->CreateShader(
 	{
@@ -132,77 +419,312 @@ void DrawText::Init(GpuDevice* device)
 		.VerticalAddress = SamplerAddress::Wrap,
 	});
 
-	CharacterData.GrowToLengthUninitialized(MaxCharactersPerFrame);
-	CharacterBuffer = Device->CreateBuffer("Character Buffer"_view,
-	{
-		.Type = BufferType::StructuredBuffer,
-		.Usage = BufferUsage::Stream,
-		.Size = MaxCharactersPerFrame * sizeof(Hlsl::Character),
-		.Stride = sizeof(Hlsl::Character),
-	});
+	CharacterData.GrowToLengthUninitialized(InitialCharacterCapacity);
+	CharacterBuffers.Add(CreateCharacterBuffer(Device));
 }
 
 void DrawText::Shutdown()
 {
 	Device->DestroySampler(&Sampler);
 	Device->DestroyPipeline(&Pipeline);
-	Device->DestroyTexture(&FontTexture);
-	Device->DestroyBuffer(&CharacterBuffer);
+
+	Textures->~TextureStreamer();
+	GlobalAllocator::Get().Deallocate(Textures, sizeof(*Textures));
+	if (FontMipMap != TextureStreamer::NotResident)
+	{
+		Device->DestroyTexture(&FontTexture);
+	}
+	for (uint32 frameIndex = 0; frameIndex < FramesInFlight; ++frameIndex)
+	{
+		if (IsFontTextureRetired[frameIndex])
+		{
+			Device->DestroyTexture(&RetiredFontTextures[frameIndex]);
+		}
+	}
+	if (FontAtlasData)
+	{
+		GlobalAllocator::Get().Deallocate(FontAtlasData, FontAtlasSize);
+	}
+	for (Buffer& buffer : CharacterBuffers)
+	{
+		Device->DestroyBuffer(&buffer);
+	}
+
+	for (CachedTextRun* run : TextRuns)
+	{
+		if (run)
+		{
+			run->~CachedTextRun();
+			GlobalAllocator::Get().Deallocate(run, sizeof(*run));
+		}
+	}
+	TextRuns.Clear();
 
 	this->~DrawText();
 }
 
-void DrawText::Draw(StringView text, Float2 position, Float3 rgb, float scale)
+void DrawText::Draw(StringView text, Float2 position, Float3 rgb, float scale, float maxWidth)
 {
-	Draw(text, position, Float4 { rgb.X, rgb.Y, rgb.Z, 1.0f }, scale);
+	Draw(text, position, Float4 { rgb.X, rgb.Y, rgb.Z, 1.0f }, scale, maxWidth);
 }
 
-void DrawText::Draw(StringView text, Float2 position, Float4 rgba, float scale)
+usize DrawText::Layout(StringView text, Float2 position, Float4 rgba, float scale, float maxWidth, Hlsl::Character* characters) const
 {
-	if (CharacterIndex + text.GetLength() > MaxCharactersPerFrame)
-	{
-		CharacterIndex = 0;
-	}
+	const float lineHeight = LineHeight * scale;
+	const float right = position.X + maxWidth;
 
 	Float2 currentPosition = { position.X, position.Y - scale * Ascender };
-	for (usize i = 0; i < text.GetLength(); ++i)
+	usize characterCount = 0;
+
+	// Quads are written as the text is read. When a word crosses the maximum width, the quads it already has are moved
+	// down to the next line, rather than measuring every word before writing it.
+	usize wordStart = 0;
+	float wordStartX = currentPosition.X;
+	bool lineIsEmpty = true;
+	bool lineHasWord = false;
+	uint32 previous = 0;
+
+	usize index = 0;
+	while (index < text.GetLength())
 	{
-		const Glyph& glyph = Glyphs[text[i]];
+		const uint32 codepoint = DecodeUtf8(text, &index);
+		if (codepoint == '\n')
+		{
+			currentPosition = { position.X, currentPosition.Y + lineHeight };
+			wordStart = characterCount;
+			wordStartX = currentPosition.X;
+			lineIsEmpty = true;
+			lineHasWord = false;
+			previous = 0;
+			continue;
+		}
+		if (codepoint == '\r')
+		{
+			continue;
+		}
+
+		const Glyph& glyph = Glyphs.Get(codepoint);
+		float kerning = (previous != 0) ? Kerning.Get(previous, codepoint) * scale : 0.0f;
 
-		CharacterData[CharacterIndex] = Hlsl::Character
+		if (codepoint == ' ')
 		{
-			.Color = rgba,
-			.ScreenPosition = currentPosition,
-			.AtlasPosition = glyph.AtlasPosition,
-			.AtlasSize = glyph.AtlasSize,
-			.PlanePosition = glyph.PlanePosition,
-			.PlaneSize = glyph.PlaneSize,
-			.Scale = scale,
-		};
+			// Spaces never wrap, a line can run past the width on the spaces between two words.
+			currentPosition.X += kerning + glyph.Advance * scale;
+			wordStart = characterCount;
+			wordStartX = currentPosition.X;
+			lineHasWord = !lineIsEmpty;
+			previous = codepoint;
+			continue;
+		}
+
+		if (maxWidth > 0.0f && !lineIsEmpty && currentPosition.X + kerning + glyph.Advance * scale > right)
+		{
+			if (lineHasWord)
+			{
+				const float shift = wordStartX - position.X;
+				for (usize i = wordStart; i < characterCount; ++i)
+				{
+					characters[i].ScreenPosition.X -= shift;
+					characters[i].ScreenPosition.Y += lineHeight;
+				}
+				currentPosition = { currentPosition.X - shift, currentPosition.Y + lineHeight };
+			}
+			else
+			{
+				currentPosition = { position.X, currentPosition.Y + lineHeight };
+				wordStart = characterCount;
+				kerning = 0.0f;
+			}
+			wordStartX = position.X;
+			lineHasWord = false;
+		}
+
+		currentPosition.X += kerning;
+
+		// Blank glyphs only move the pen, there is nothing to draw for them.
+		if (glyph.PlaneSize.X != 0.0f && glyph.PlaneSize.Y != 0.0f)
+		{
+			characters[characterCount] = Hlsl::Character
+			{
+				.Color = rgba,
+				.ScreenPosition = currentPosition,
+				.AtlasPosition = glyph.AtlasPosition,
+				.AtlasSize = glyph.AtlasSize,
+				.PlanePosition = glyph.PlanePosition,
+				.PlaneSize = glyph.PlaneSize,
+				.Scale = scale,
+			};
+			++characterCount;
+		}
 
 		currentPosition.X += glyph.Advance * scale;
-		++CharacterIndex;
+		lineIsEmpty = false;
+		previous = codepoint;
 	}
+	return characterCount;
+}
+
+Hlsl::Character* DrawText::AllocateCharacters(usize count)
+{
+	const usize required = CharacterIndex + count;
+	if (required > CharacterData.GetLength())
+	{
+		usize capacity = Max(CharacterData.GetLength(), InitialCharacterCapacity);
+		while (capacity < required)
+		{
+			capacity *= 2;
+		}
+		CharacterData.GrowToLengthUninitialized(capacity);
+	}
+	return CharacterData.GetData() + CharacterIndex;
+}
+
+void DrawText::Draw(StringView text, Float2 position, Float4 rgba, float scale, float maxWidth)
+{
+	// Every character takes at least one byte, so the byte length bounds the number of quads.
+	Hlsl::Character* characters = AllocateCharacters(text.GetLength());
+	CharacterIndex += Layout(text, position, rgba, scale, maxWidth, characters);
+}
+
+TextRun DrawText::CreateTextRun()
+{
+	CachedTextRun* run = GlobalAllocator::Get().Create<CachedTextRun>();
+	run->Position = { 0.0f, 0.0f };
+	run->Color = { 0.0f, 0.0f, 0.0f, 0.0f };
+	run->Scale = 0.0f;
+	run->MaxWidth = 0.0f;
+	run->CharacterCount = 0;
+
+	// An overlay has a handful of runs, so the slots of destroyed runs are found by looking for them.
+	for (uint32 index = 0; index < TextRuns.GetLength(); ++index)
+	{
+		if (!TextRuns[index])
+		{
+			TextRuns[index] = run;
+			return TextRun { index };
+		}
+	}
+
+	TextRuns.Add(run);
+	return TextRun { static_cast<uint32>(TextRuns.GetLength() - 1) };
+}
+
+void DrawText::DestroyTextRun(TextRun* run)
+{
+	CHECK(run);
+
+	CachedTextRun* cached = TextRuns[run->Index];
+	CHECK(cached);
+	cached->~CachedTextRun();
+	GlobalAllocator::Get().Deallocate(cached, sizeof(*cached));
+
+	TextRuns[run->Index] = nullptr;
+	run->Index = ~0u;
+}
+
+bool DrawText::UpdateTextRun(TextRun run, StringView text, Float2 position, Float4 rgba, float scale, float maxWidth)
+{
+	CachedTextRun* cached = TextRuns[run.Index];
+	CHECK(cached);
+
+	const bool isSameText = cached->Text.GetLength() == text.GetLength() &&
+							(text.IsEmpty() || memcmp(cached->Text.GetData(), text.GetData(), text.GetLength()) == 0);
+	const bool isSamePlacement = cached->Position.X == position.X && cached->Position.Y == position.Y &&
+								 cached->Scale == scale && cached->MaxWidth == maxWidth;
+	const bool isSameColor = cached->Color.X == rgba.X && cached->Color.Y == rgba.Y && cached->Color.Z == rgba.Z && cached->Color.W == rgba.W;
+	if (isSameText && isSamePlacement && isSameColor)
+	{
+		return false;
+	}
+
+	cached->Text.Clear();
+	cached->Text.GrowToLengthUninitialized(text.GetLength());
+	if (!text.IsEmpty())
+	{
+		Platform::MemoryCopy(cached->Text.GetData(), text.GetData(), text.GetLength());
+	}
+	cached->Position = position;
+	cached->Color = rgba;
+	cached->Scale = scale;
+	cached->MaxWidth = maxWidth;
+
+	cached->Characters.GrowToLengthUninitialized(text.GetLength());
+	cached->CharacterCount = Layout(text, position, rgba, scale, maxWidth, cached->Characters.GetData());
+	return true;
+}
+
+void DrawText::Draw(TextRun run)
+{
+	const CachedTextRun* cached = TextRuns[run.Index];
+	CHECK(cached);
+
+	const usize characterCount = cached->CharacterCount;
+	Hlsl::Character* characters = AllocateCharacters(characterCount);
+	if (characterCount != 0)
+	{
+		Platform::MemoryCopy(characters, cached->Characters.GetData(), characterCount * sizeof(Hlsl::Character));
+	}
+	CharacterIndex += characterCount;
 }
 
 void DrawText::Submit(GraphicsContext* graphics, uint32 width, uint32 height)
 {
 	CHECK(graphics);
 
+	const usize characterCount = CharacterIndex;
+	CharacterIndex = 0;
+
+	const uint32 frameIndex = Device->GetFrameIndex();
+	if (IsFontTextureRetired[frameIndex])
+	{
+		Device->DestroyTexture(&RetiredFontTextures[frameIndex]);
+		IsFontTextureRetired[frameIndex] = false;
+	}
+
+	// Every mip read since the last frame is gathered first, so the texture is created at most once a frame.
+	Textures->Update([this](uint32, const DdsImage& image, uint32 mipMap, const uint8* data)
+	{
+		GatherFontAtlas(image, mipMap, data);
+	});
+	const uint32 residentMipMap = Textures->GetResidentMipMap(FontAtlas);
+	if (residentMipMap != FontMipMap)
+	{
+		RaiseFontTexture(residentMipMap);
+	}
+
+	const usize chunkCount = (characterCount + CharacterChunkSize - 1) / CharacterChunkSize;
+	while (CharacterBuffers.GetLength() < chunkCount)
+	{
+		CharacterBuffers.Add(CreateCharacterBuffer(Device));
+	}
+
+	Statistics.Characters = characterCount;
+	Statistics.HighWaterMark = Max(Statistics.HighWaterMark, characterCount);
+	Statistics.Capacity = CharacterBuffers.GetLength() * CharacterChunkSize;
+	Statistics.UploadedBytes = 0;
+
+	if (characterCount == 0 || FontMipMap == TextureStreamer::NotResident)
+	{
+		return;
+	}
+
 	RootConstants.ViewProjection = Matrix::Orthographic(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), 0.0f, 1.0f);
 
-	RootConstants.CharacterBuffer = Device->Get(CharacterBuffer);
 	RootConstants.Texture = Device->Get(FontTexture);
 	RootConstants.Sampler = Device->Get(Sampler);
 
-	Device->Write(CharacterBuffer, CharacterData.GetData());
-
 	graphics->SetPipeline(&Pipeline);
 
-	graphics->SetRootConstants(&RootConstants);
-
 	static constexpr usize verticesPerQuad = 6;
-	graphics->Draw(CharacterIndex * verticesPerQuad);
+	for (usize chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const usize first = chunk * CharacterChunkSize;
+		Device->Write(CharacterBuffers[chunk], CharacterData.GetData() + first);
+		Statistics.UploadedBytes += CharacterChunkSize * sizeof(Hlsl::Character);
 
-	CharacterIndex = 0;
+		RootConstants.CharacterBuffer = Device->Get(CharacterBuffers[chunk]);
+		graphics->SetRootConstants(&RootConstants);
+
+		graphics->Draw(Min(characterCount - first, CharacterChunkSize) * verticesPerQuad);
+	}
 }
@@ -1,18 +1,15 @@
 #pragma once
 
+#include "GlyphTable.hpp"
+
 #include "Luft/Math.hpp"
 #include "Luft/NoCopy.hpp"
 
 #include "RHI/RHI.hpp"
 
-struct Glyph
-{
-	Float2 AtlasPosition;
-	Float2 AtlasSize;
-	Float2 PlanePosition;
-	Float2 PlaneSize;
-	float Advance;
-};
+class JsonCursor;
+class TextureStreamer;
+struct DdsImage;
 
 namespace Hlsl
 {
@@ -44,6 +41,24 @@ struct Character
 
 }
 
+// Text laid out once and kept between frames, for the lines of an overlay that rarely change.
+struct TextRun
+{
+	uint32 Index;
+};
+
+struct TextStatistics
+{
+	// Characters drawn in the last frame and the most drawn in any frame.
+	usize Characters;
+	usize HighWaterMark;
+
+	// Characters the GPU buffers hold. A frame uploads only the buffers it draws from, so it uploads less than a buffer
+	// more than it drew.
+	usize Capacity;
+	usize UploadedBytes;
+};
+
 class DrawText : public NoCopy
 {
 public:
@@ -58,27 +73,78 @@ public:
 		return instance;
 	}
 
-	void Draw(StringView text, Float2 position, Float3 rgb, float scale);
-	void Draw(StringView text, Float2 position, Float4 rgba, float scale);
+	// Text is UTF-8 and lines break at newlines. With a maximum width, lines also break before the first word that would
+	// cross it, and words wider than the whole width break between characters.
+	void Draw(StringView text, Float2 position, Float3 rgb, float scale, float maxWidth = 0.0f);
+	void Draw(StringView text, Float2 position, Float4 rgba, float scale, float maxWidth = 0.0f);
+
+	TextRun CreateTextRun();
+	void DestroyTextRun(TextRun* run);
+
+	// Lays the run out again only when the text or any of its settings differ from the last update, otherwise this is a
+	// comparison. Returns whether it was laid out.
+	bool UpdateTextRun(TextRun run, StringView text, Float2 position, Float4 rgba, float scale, float maxWidth = 0.0f);
+	// Copies the quads of the run into this frame's characters.
+	void Draw(TextRun run);
 
 	void Submit(GraphicsContext* graphics, uint32 width, uint32 height);
 
+	// As of the last Submit.
+	const TextStatistics& GetStatistics() const { return Statistics; }
+
 private:
-	HashTable<char, Glyph> Glyphs;
+	struct CachedTextRun;
+
+	// Writes at most one quad for every byte of text and returns how many it wrote.
+	usize Layout(StringView text, Float2 position, Float4 rgba, float scale, float maxWidth, Hlsl::Character* characters) const;
+
+	// Room for count more characters this frame, growing the frame's characters when they are full.
+	Hlsl::Character* AllocateCharacters(usize count);
+
+	void ReadGlyph(JsonCursor* cursor, uint32 atlasWidth, uint32 atlasHeight);
+	void ReadKerningPair(JsonCursor* cursor);
+
+	void GatherFontAtlas(const DdsImage& image, uint32 mipMap, const uint8* data);
+	void RaiseFontTexture(uint32 mipMap);
+
+	GlyphTable Glyphs;
+	KerningTable Kerning;
 
 	float Ascender;
+	float LineHeight;
 
 	Hlsl::TextRootConstants RootConstants;
 
 	usize CharacterIndex;
 	Array<Hlsl::Character> CharacterData;
 
+	TextStatistics Statistics;
+
+	// Destroyed runs leave a null slot for the next run to take.
+	Array<CachedTextRun*> TextRuns;
+
 	GraphicsPipeline Pipeline;
 
+	// Streamed in after Init returns. Text is drawn from the smallest mip on, and the texture is created again with more
+	// levels as the larger mips arrive.
+	TextureStreamer* Textures;
+	uint32 FontAtlas;
 	Texture FontTexture;
+	// The most detailed level FontTexture holds, or TextureStreamer::NotResident before it is created.
+	uint32 FontMipMap;
+	// The mips of the atlas read so far, until the whole atlas is resident.
+	uint8* FontAtlasData;
+	usize FontAtlasSize;
+
+	// Font textures replaced by a more detailed one, by the frame index they were replaced in. A frame only comes around
+	// again once the frames before it are done with them.
+	Texture RetiredFontTextures[FramesInFlight];
+	bool IsFontTextureRetired[FramesInFlight];
+
 	Sampler Sampler;
 
-	Buffer CharacterBuffer;
+	// Consecutive chunks of the frame's characters, kept once created.
+	Array<Buffer> CharacterBuffers;
 
 	GpuDevice* Device;
 };
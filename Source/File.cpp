@@ -0,0 +1,385 @@
+#include "File.hpp"
+
+#include "Luft/Math.hpp"
+
+#include <stdio.h>
+
+#if WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr usize MaxFilePathLength = 512;
+
+static void ToCString(StringView filePath, char* buffer, usize bufferSize)
+{
+	VERIFY(filePath.GetLength() < bufferSize, "File path is too long!");
+	Platform::MemoryCopy(buffer, filePath.GetData(), filePath.GetLength());
+	buffer[filePath.GetLength()] = '\0';
+}
+
+bool WriteEntireFile(StringView filePath, const void* data, usize dataSize)
+{
+	char path[MaxFilePathLength];
+	ToCString(filePath, path, sizeof(path));
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+	const usize written = fwrite(data, 1, dataSize, file);
+	const bool closed = fclose(file) == 0;
+	return written == dataSize && closed;
+}
+
+bool ReplaceEntireFile(StringView filePath, const void* data, usize dataSize)
+{
+	char path[MaxFilePathLength];
+	ToCString(filePath, path, sizeof(path));
+
+	// The process ID keeps processes that replace the same file at once from writing the same temporary file.
+#if WINDOWS
+	const uint32 processId = static_cast<uint32>(GetCurrentProcessId());
+#else
+	const uint32 processId = static_cast<uint32>(getpid());
+#endif
+	char temporaryPath[MaxFilePathLength];
+	const int32 temporaryPathLength = snprintf(temporaryPath, sizeof(temporaryPath), "%s.%u.tmp", path, processId);
+	VERIFY(temporaryPathLength > 0 && static_cast<usize>(temporaryPathLength) < sizeof(temporaryPath), "File path is too long!");
+
+	if (!WriteEntireFile(StringView { temporaryPath, static_cast<usize>(temporaryPathLength) }, data, dataSize))
+	{
+		remove(temporaryPath);
+		return false;
+	}
+
+#if WINDOWS
+	wchar_t widePath[MaxFilePathLength];
+	wchar_t wideTemporaryPath[MaxFilePathLength];
+	const bool renamed = MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, static_cast<int32>(ARRAY_COUNT(widePath))) != 0 &&
+						 MultiByteToWideChar(CP_UTF8, 0, temporaryPath, -1, wideTemporaryPath, static_cast<int32>(ARRAY_COUNT(wideTemporaryPath))) != 0 &&
+						 MoveFileExW(wideTemporaryPath, widePath, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	const bool renamed = rename(temporaryPath, path) == 0;
+#endif
+	if (!renamed)
+	{
+		remove(temporaryPath);
+	}
+	return renamed;
+}
+
+uint8* TryReadEntireFile(StringView filePath, usize* fileSize, Allocator& allocator)
+{
+	CHECK(fileSize);
+
+	char path[MaxFilePathLength];
+	ToCString(filePath, path, sizeof(path));
+
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	uint8* data = nullptr;
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		const long size = ftell(file);
+		if (size >= 0 && fseek(file, 0, SEEK_SET) == 0)
+		{
+			*fileSize = static_cast<usize>(size);
+			data = static_cast<uint8*>(allocator.Allocate(*fileSize));
+			if (fread(data, 1, *fileSize, file) != *fileSize)
+			{
+				allocator.Deallocate(data, *fileSize);
+				data = nullptr;
+			}
+		}
+	}
+	fclose(file);
+	return data;
+}
+
+// Stands in for the contents of an empty file, which cannot be mapped, so that an open file always has data.
+static const uint8 EmptyFileData[1] = {};
+
+MappedFile::MappedFile()
+	: Data(nullptr)
+	, Size(0)
+	, Mapped(false)
+{
+}
+
+MappedFile::MappedFile(StringView filePath)
+	: MappedFile()
+{
+	const bool opened = Open(filePath);
+	VERIFY(opened, "Failed to open file!");
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+	: Data(other.Data)
+	, Size(other.Size)
+	, Mapped(other.Mapped)
+{
+	other.Data = nullptr;
+	other.Size = 0;
+	other.Mapped = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other)
+	{
+		Close();
+		Data = other.Data;
+		Size = other.Size;
+		Mapped = other.Mapped;
+		other.Data = nullptr;
+		other.Size = 0;
+		other.Mapped = false;
+	}
+	return *this;
+}
+
+bool MappedFile::Open(StringView filePath)
+{
+	Close();
+
+	char path[MaxFilePathLength];
+	ToCString(filePath, path, sizeof(path));
+
+#if WINDOWS
+	wchar_t widePath[MaxFilePathLength];
+	if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, static_cast<int32>(ARRAY_COUNT(widePath))) == 0)
+	{
+		return false;
+	}
+
+	const HANDLE file = CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	const bool isDiskFile = GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize);
+	if (isDiskFile && fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		Data = EmptyFileData;
+		return true;
+	}
+
+	// The view holds its own references to the mapping and the file, so neither handle is needed past this point.
+	const HANDLE mapping = isDiskFile ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(file);
+	if (mapping)
+	{
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view)
+		{
+			Data = static_cast<const uint8*>(view);
+			Size = static_cast<usize>(fileSize.QuadPart);
+			Mapped = true;
+			return true;
+		}
+	}
+#else
+	const int32 file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return false;
+	}
+
+	if (S_ISREG(status.st_mode) && status.st_size == 0)
+	{
+		close(file);
+		Data = EmptyFileData;
+		return true;
+	}
+
+	// The mapping holds its own reference to the file, so the descriptor is not needed past this point.
+	void* mapping = S_ISREG(status.st_mode) ? mmap(nullptr, static_cast<usize>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	close(file);
+	if (mapping != MAP_FAILED)
+	{
+		Data = static_cast<const uint8*>(mapping);
+		Size = static_cast<usize>(status.st_size);
+		Mapped = true;
+		return true;
+	}
+#endif
+
+	usize fileSize = 0;
+	const uint8* fileData = TryReadEntireFile(filePath, &fileSize, GlobalAllocator::Get());
+	if (!fileData)
+	{
+		return false;
+	}
+	Data = fileData;
+	Size = fileSize;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Mapped)
+	{
+#if WINDOWS
+		UnmapViewOfFile(Data);
+#else
+		munmap(const_cast<uint8*>(Data), Size);
+#endif
+	}
+	else if (Data && Data != EmptyFileData)
+	{
+		GlobalAllocator::Get().Deallocate(const_cast<uint8*>(Data), Size);
+	}
+	Data = nullptr;
+	Size = 0;
+	Mapped = false;
+}
+
+FileReader::FileReader()
+#if WINDOWS
+	: Handle(nullptr)
+#else
+	: Descriptor(-1)
+#endif
+	, Size(0)
+	, Opened(false)
+{
+}
+
+FileReader::~FileReader()
+{
+	Close();
+}
+
+bool FileReader::Open(StringView filePath)
+{
+	Close();
+
+	char path[MaxFilePathLength];
+	ToCString(filePath, path, sizeof(path));
+
+#if WINDOWS
+	wchar_t widePath[MaxFilePathLength];
+	if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, static_cast<int32>(ARRAY_COUNT(widePath))) == 0)
+	{
+		return false;
+	}
+
+	const HANDLE file = CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	Handle = file;
+	Size = static_cast<usize>(fileSize.QuadPart);
+#else
+	const int32 file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		close(file);
+		return false;
+	}
+	Descriptor = file;
+	Size = static_cast<usize>(status.st_size);
+#endif
+	Opened = true;
+	return true;
+}
+
+void FileReader::Close()
+{
+	if (Opened)
+	{
+#if WINDOWS
+		CloseHandle(Handle);
+		Handle = nullptr;
+#else
+		close(Descriptor);
+		Descriptor = -1;
+#endif
+	}
+	Size = 0;
+	Opened = false;
+}
+
+bool FileReader::Read(usize offset, void* data, usize size) const
+{
+	CHECK(Opened);
+	if (offset > Size || size > Size - offset)
+	{
+		return false;
+	}
+
+	// A single call reads less than asked for past a platform limit, so large ranges take a few.
+	uint8* bytes = static_cast<uint8*>(data);
+	while (size != 0)
+	{
+#if WINDOWS
+		OVERLAPPED position = {};
+		position.Offset = static_cast<DWORD>(offset);
+		position.OffsetHigh = static_cast<DWORD>(static_cast<uint64>(offset) >> 32);
+
+		DWORD read = 0;
+		const DWORD toRead = static_cast<DWORD>(Min<usize>(size, 1u << 30));
+		if (!ReadFile(Handle, bytes, toRead, &read, &position) || read == 0)
+		{
+			return false;
+		}
+#else
+		const ssize_t read = pread(Descriptor, bytes, size, static_cast<off_t>(offset));
+		if (read < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (read <= 0)
+		{
+			return false;
+		}
+#endif
+		bytes += read;
+		offset += static_cast<usize>(read);
+		size -= static_cast<usize>(read);
+	}
+	return true;
+}
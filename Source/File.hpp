@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Luft/Base.hpp"
+#include "Luft/String.hpp"
+
+bool WriteEntireFile(StringView filePath, const void* data, usize dataSize);
+
+// Writes a temporary file next to the destination and renames it over the destination, so readers see either the old file
+// or the new one, and a process that has the old file mapped keeps reading the old contents. On Windows the rename fails
+// while another process has the destination open, and then the destination is left as it was.
+bool ReplaceEntireFile(StringView filePath, const void* data, usize dataSize);
+
+// Returns null rather than failing when the file is missing or unreadable, for files that are only an optimization.
+uint8* TryReadEntireFile(StringView filePath, usize* fileSize, Allocator& allocator);
+
+// A whole file, read-only. The file is mapped, so its pages are loaded on first touch and shared with the page cache, and
+// loaders can hand out views into the file without keeping a second copy. Files that cannot be mapped are read into memory.
+class MappedFile
+{
+public:
+	MappedFile();
+	explicit MappedFile(StringView filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+	// Returns false rather than failing when the file is missing or unreadable.
+	bool Open(StringView filePath);
+	void Close();
+
+	bool IsOpen() const { return Data != nullptr; }
+	bool IsMapped() const { return Mapped; }
+
+	const uint8* GetData() const { return Data; }
+	usize GetSize() const { return Size; }
+	StringView GetView() const { return StringView { reinterpret_cast<const char*>(Data), Size }; }
+
+private:
+	const uint8* Data;
+	usize Size;
+	bool Mapped;
+};
+
+// An open file read a range at a time, for loaders that only want part of a file in memory at once.
+class FileReader
+{
+public:
+	FileReader();
+	~FileReader();
+
+	FileReader(const FileReader&) = delete;
+	FileReader& operator=(const FileReader&) = delete;
+
+	// Returns false rather than failing when the file is missing or unreadable.
+	bool Open(StringView filePath);
+	void Close();
+
+	bool IsOpen() const { return Opened; }
+	usize GetSize() const { return Size; }
+
+	// Returns false when the range runs past the end of the file or cannot be read. Reads at different offsets do not share
+	// a file position, so they can come from more than one thread.
+	bool Read(usize offset, void* data, usize size) const;
+
+private:
+#if WINDOWS
+	void* Handle;
+#else
+	int32 Descriptor;
+#endif
+	usize Size;
+	bool Opened;
+};
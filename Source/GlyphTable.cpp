@@ -0,0 +1,111 @@
+#include "GlyphTable.hpp"
+
+static constexpr uint32 ReplacementCharacter = 0xFFFD;
+static constexpr uint32 QuestionMark = '?';
+static constexpr uint32 MaxCodepoint = 0x10FFFF;
+
+GlyphTable::GlyphTable()
+{
+	// Lookups before Build get the empty glyph rather than reading past the end.
+	Build();
+}
+
+void GlyphTable::Add(uint32 codepoint, const Glyph& glyph)
+{
+	VERIFY(codepoint <= MaxCodepoint, "Glyph is outside of Unicode!");
+	Added.Add(AddedGlyph { codepoint, glyph });
+}
+
+void GlyphTable::Build()
+{
+	Glyph fallback = {};
+	bool hasReplacementCharacter = false;
+	uint32 lastPage = 0;
+	for (const AddedGlyph& added : Added)
+	{
+		if (added.Codepoint == ReplacementCharacter || (added.Codepoint == QuestionMark && !hasReplacementCharacter))
+		{
+			fallback = added.Metrics;
+			hasReplacementCharacter = added.Codepoint == ReplacementCharacter;
+		}
+		lastPage = Max(lastPage, added.Codepoint >> GlyphPageBits);
+	}
+
+	PageIndices.Clear();
+	Pages.Clear();
+	if (!Added.IsEmpty())
+	{
+		PageIndices.GrowToLengthUninitialized(static_cast<usize>(lastPage) + 1);
+		Platform::MemorySet(PageIndices.GetData(), 0, PageIndices.GetLength() * sizeof(uint16));
+	}
+
+	usize pageCount = 1;
+	for (const AddedGlyph& added : Added)
+	{
+		uint16& pageIndex = PageIndices[added.Codepoint >> GlyphPageBits];
+		if (pageIndex == 0)
+		{
+			VERIFY(pageCount <= 0xFFFF, "Font has too many glyph pages!");
+			pageIndex = static_cast<uint16>(pageCount++);
+		}
+	}
+
+	Pages.GrowToLengthUninitialized(pageCount * GlyphPageSize);
+	for (Glyph& glyph : Pages)
+	{
+		glyph = fallback;
+	}
+	for (const AddedGlyph& added : Added)
+	{
+		const usize pageIndex = PageIndices[added.Codepoint >> GlyphPageBits];
+		Pages[(pageIndex << GlyphPageBits) | (added.Codepoint & (GlyphPageSize - 1))] = added.Metrics;
+	}
+
+	Added.Clear();
+}
+
+KerningTable::KerningTable()
+	: SlotMask(0)
+	, SlotShift(0)
+	, PairCount(0)
+{
+	Build();
+}
+
+void KerningTable::Add(uint32 first, uint32 second, float advance)
+{
+	VERIFY(first <= MaxCodepoint && second <= MaxCodepoint, "Kerning pair is outside of Unicode!");
+	Added.Add(KerningPair { GetKey(first, second), advance });
+}
+
+void KerningTable::Build()
+{
+	uint32 slotBits = 1;
+	while ((static_cast<usize>(1) << slotBits) < Added.GetLength() * 2)
+	{
+		++slotBits;
+	}
+	SlotMask = (static_cast<usize>(1) << slotBits) - 1;
+	SlotShift = 64 - slotBits;
+
+	Slots.Clear();
+	Slots.GrowToLengthUninitialized(SlotMask + 1);
+	for (KerningPair& pair : Slots)
+	{
+		pair = KerningPair { EmptyKey, 0.0f };
+	}
+
+	PairCount = 0;
+	for (const KerningPair& added : Added)
+	{
+		usize slot = GetSlot(added.Key);
+		while (Slots[slot].Key != EmptyKey && Slots[slot].Key != added.Key)
+		{
+			slot = (slot + 1) & SlotMask;
+		}
+		PairCount += (Slots[slot].Key == EmptyKey) ? 1 : 0;
+		Slots[slot] = added;
+	}
+
+	Added.Clear();
+}
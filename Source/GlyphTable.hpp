@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Luft/Array.hpp"
+#include "Luft/Base.hpp"
+#include "Luft/Math.hpp"
+
+struct Glyph
+{
+	Float2 AtlasPosition;
+	Float2 AtlasSize;
+	Float2 PlanePosition;
+	Float2 PlaneSize;
+	float Advance;
+};
+
+static constexpr uint32 GlyphPageBits = 8;
+static constexpr uint32 GlyphPageSize = 1 << GlyphPageBits;
+
+// Glyph metrics indexed by codepoint through two levels: the page of the codepoint, then the glyph within it. Fonts cover
+// a few dense ranges, so only the pages they have glyphs in are stored, and every other page shares the fallback page.
+class GlyphTable
+{
+public:
+	GlyphTable();
+
+	// A later glyph for the same codepoint replaces an earlier one. Every glyph is added before Build.
+	void Add(uint32 codepoint, const Glyph& glyph);
+	void Build();
+
+	// Codepoints the font has no glyph for get the fallback glyph: the replacement character, a question mark in fonts
+	// without one and an empty glyph in fonts with neither.
+	const Glyph& Get(uint32 codepoint) const
+	{
+		const uint32 page = codepoint >> GlyphPageBits;
+		const usize pageIndex = (page < PageIndices.GetLength()) ? PageIndices[page] : 0;
+		return Pages[(pageIndex << GlyphPageBits) | (codepoint & (GlyphPageSize - 1))];
+	}
+
+	usize GetPageCount() const { return Pages.GetLength() / GlyphPageSize; }
+
+private:
+	struct AddedGlyph
+	{
+		uint32 Codepoint;
+		Glyph Metrics;
+	};
+
+	Array<AddedGlyph> Added;
+
+	// Up to the last page with a glyph in it, zero for the pages without.
+	Array<uint16> PageIndices;
+	// GlyphPageSize glyphs for each page, the first of which is all fallback glyphs.
+	Array<Glyph> Pages;
+};
+
+// Advance adjustments for pairs of codepoints, in an open-addressed table a power of two in size and at most half full. A
+// lookup hashes the pair once and reads consecutive slots until the pair or an empty slot, so fonts without kerning pay for
+// a single load.
+class KerningTable
+{
+public:
+	KerningTable();
+
+	// A later adjustment for the same pair replaces an earlier one. Every pair is added before Build.
+	void Add(uint32 first, uint32 second, float advance);
+	void Build();
+
+	// Zero for pairs the font does not adjust.
+	float Get(uint32 first, uint32 second) const
+	{
+		const uint64 key = GetKey(first, second);
+		for (usize slot = GetSlot(key);; slot = (slot + 1) & SlotMask)
+		{
+			const KerningPair& pair = Slots[slot];
+			if (pair.Key == key)
+			{
+				return pair.Advance;
+			}
+			if (pair.Key == EmptyKey)
+			{
+				return 0.0f;
+			}
+		}
+	}
+
+	usize GetPairCount() const { return PairCount; }
+
+private:
+	// No pair of codepoints has every bit set.
+	static constexpr uint64 EmptyKey = ~0ull;
+
+	struct KerningPair
+	{
+		uint64 Key;
+		float Advance;
+	};
+
+	static uint64 GetKey(uint32 first, uint32 second) { return (static_cast<uint64>(first) << 32) | second; }
+	usize GetSlot(uint64 key) const { return static_cast<usize>((key * 0x9E3779B97F4A7C15ull) >> SlotShift); }
+
+	Array<KerningPair> Added;
+
+	Array<KerningPair> Slots;
+	usize SlotMask;
+	uint32 SlotShift;
+	usize PairCount;
+};
@@ -0,0 +1,211 @@
+#include "CameraController.hpp"
+#include "CommandLine.hpp"
+#include "CpuRaytracer.hpp"
+#include "Image.hpp"
+#include "Log.hpp"
+#include "Scene.hpp"
+#include "ThreadPool.hpp"
+
+struct OfflineSettings
+{
+	StringView OutputPath;
+	StringView ScenePath;
+
+	uint32 Width;
+	uint32 Height;
+
+	uint32 TargetSamples;
+	double TimeBudgetSeconds;
+	// Negative unless --noise is given, the scene's threshold applies then.
+	double NoiseThreshold;
+
+	bool UseBvh;
+};
+
+static void LogUsage()
+{
+	Platform::Log("Usage: EosHeadless [--output <file.png|file.exr|file.pfm>] [--scene <file.json>] [--samples <passes>] [--time <seconds>]\n"
+				  "                   [--noise <relative error>] [--width <pixels>] [--height <pixels>] [--no-bvh]\n"
+				  "Renders until the pass target or the time budget is reached, whichever comes first.\n"
+				  "With a noise threshold, converged pixels stop sampling and the render ends once all of them have.\n"
+				  "The threshold defaults to the scene's, --noise 0 samples every pixel on every pass.\n");
+}
+
+static bool ParseSettings(const Array<StringView>& arguments, OfflineSettings* settings)
+{
+	CHECK(settings);
+
+	for (usize i = 0; i < arguments.GetLength(); ++i)
+	{
+		const StringView argument = arguments[i];
+		const bool hasValue = i + 1 < arguments.GetLength();
+
+		bool valid = true;
+		if (argument == "--output"_view && hasValue)
+		{
+			settings->OutputPath = arguments[++i];
+			valid = GetImageFileFormat(settings->OutputPath) != ImageFileFormat::None;
+		}
+		else if (argument == "--scene"_view && hasValue)
+		{
+			// Read in Start with FindCommandLineValue, like the interactive build does.
+			++i;
+		}
+		else if (argument == "--samples"_view && hasValue)
+		{
+			valid = ParseCommandLineUint32(arguments[++i], &settings->TargetSamples) && settings->TargetSamples != 0;
+		}
+		else if (argument == "--time"_view && hasValue)
+		{
+			valid = ParseCommandLineDouble(arguments[++i], &settings->TimeBudgetSeconds) && settings->TimeBudgetSeconds >= 0.0;
+		}
+		else if (argument == "--noise"_view && hasValue)
+		{
+			valid = ParseCommandLineDouble(arguments[++i], &settings->NoiseThreshold) && settings->NoiseThreshold >= 0.0;
+		}
+		else if (argument == "--width"_view && hasValue)
+		{
+			valid = ParseCommandLineUint32(arguments[++i], &settings->Width) && settings->Width != 0;
+		}
+		else if (argument == "--height"_view && hasValue)
+		{
+			valid = ParseCommandLineUint32(arguments[++i], &settings->Height) && settings->Height != 0;
+		}
+		else if (argument == "--no-bvh"_view)
+		{
+			settings->UseBvh = false;
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Start()
+{
+	OfflineSettings settings =
+	{
+		.OutputPath = "Render.png"_view,
+		.ScenePath = StringView {},
+		.Width = 1280,
+		.Height = 720,
+		.TargetSamples = 64,
+		.TimeBudgetSeconds = 0.0,
+		.NoiseThreshold = -1.0,
+		.UseBvh = true,
+	};
+	const Array<StringView> arguments = GetCommandLineArguments();
+	if (!ParseSettings(arguments, &settings))
+	{
+		LogUsage();
+		return;
+	}
+	settings.ScenePath = FindCommandLineValue(arguments, "--scene"_view);
+
+	const double loadStart = Platform::GetTime();
+	Scene description = settings.ScenePath.IsEmpty() ? CreateDemoScene() : LoadScene(settings.ScenePath);
+	const double loadTime = Platform::GetTime() - loadStart;
+
+	const double noiseThreshold = (settings.NoiseThreshold < 0.0) ? description.NoiseThreshold : settings.NoiseThreshold;
+
+	const double buildStart = Platform::GetTime();
+	const CpuScene scene = CreateCpuScene(Move(description.Spheres), settings.UseBvh);
+	Log("Offline: loaded the scene in %.2f ms, prepared %zu spheres and %zu BVH nodes in %.2f ms\n",
+		loadTime * 1000.0, scene.Spheres.GetLength(), scene.BvhNodes.GetLength(), (Platform::GetTime() - buildStart) * 1000.0);
+
+	CameraController cameraController;
+	cameraController.SetView(description.Camera.Position, description.Camera.YawRadians, description.Camera.PitchRadians);
+	const Vector position = cameraController.GetPosition();
+
+	CpuRaytracer raytracer(settings.Width, settings.Height, &ThreadPool::Get());
+
+	const usize pixelCount = static_cast<usize>(settings.Width) * settings.Height;
+
+	uint32 passes = 0;
+	uint64 sampleCount = 0;
+	uint64 rayCount = 0;
+	usize convergedPixelCount = 0;
+
+	const double renderStart = Platform::GetTime();
+	double renderTime = 0.0;
+	while (passes < settings.TargetSamples)
+	{
+		const Hlsl::TraceRootConstants rootConstants =
+		{
+			.Orientation = cameraController.GetOrientation(),
+			.Position = Float3 { position.X, position.Y, position.Z },
+			.FrameIndex = passes,
+			.MaxDepth = description.MaxDepth,
+			.SamplesPerPixel = description.SamplesPerPixel,
+			.NoiseThreshold = static_cast<float>(noiseThreshold),
+			.SpheresBufferCount = static_cast<uint32>(scene.Spheres.GetLength()),
+		};
+		raytracer.Render(rootConstants, scene);
+
+		++passes;
+		sampleCount += raytracer.GetSampleCount();
+		rayCount += raytracer.GetRayCount();
+		convergedPixelCount = raytracer.GetConvergedPixelCount();
+		renderTime = Platform::GetTime() - renderStart;
+
+		if (convergedPixelCount == pixelCount)
+		{
+			break;
+		}
+		if (settings.TimeBudgetSeconds != 0.0 && renderTime >= settings.TimeBudgetSeconds)
+		{
+			break;
+		}
+	}
+
+	const double pixelSamples = static_cast<double>(sampleCount);
+	Log("Offline: %u passes, %.2f samples per pixel on average in %.2f s on %zu threads\n",
+		passes, pixelSamples / static_cast<double>(pixelCount), renderTime, ThreadPool::Get().GetThreadCount());
+	Log("Offline: %.2f M samples/s, %.2f M rays/s\n", pixelSamples / renderTime / 1.0e6, static_cast<double>(rayCount) / renderTime / 1.0e6);
+	if (noiseThreshold != 0.0)
+	{
+		Log("Offline: %zu of %zu pixels converged below a relative error of %.4f\n", convergedPixelCount, pixelCount, noiseThreshold);
+	}
+
+	const TileStatistics& tiles = raytracer.GetScheduler().GetStatistics();
+	Log("Offline: last pass %zu tiles, %zu stolen, %.3f/%.3f/%.3f ms min/average/max per tile\n",
+		tiles.TileCount, tiles.StolenCount, tiles.MinimumSeconds * 1000.0, tiles.AverageSeconds * 1000.0, tiles.MaximumSeconds * 1000.0);
+
+	const ImageFileFormat format = GetImageFileFormat(settings.OutputPath);
+
+	Array<Float3> linear(&GlobalAllocator::Get());
+	if (format == ImageFileFormat::OpenExr || format == ImageFileFormat::Pfm)
+	{
+		linear.GrowToLengthUninitialized(pixelCount);
+		raytracer.ResolveLinear(linear.GetData());
+	}
+
+	bool written = false;
+	switch (format)
+	{
+	case ImageFileFormat::Png:
+	{
+		Array<uint8> rgba(&GlobalAllocator::Get());
+		rgba.GrowToLengthUninitialized(pixelCount * 4);
+		raytracer.ResolveRgba8(rgba.GetData());
+		written = WritePngImage(settings.OutputPath, rgba.GetData(), settings.Width, settings.Height);
+		break;
+	}
+	case ImageFileFormat::OpenExr:
+		written = WriteOpenExrImage(settings.OutputPath, linear.GetData(), settings.Width, settings.Height);
+		break;
+	case ImageFileFormat::Pfm:
+		written = WritePfmImage(settings.OutputPath, linear.GetData(), settings.Width, settings.Height);
+		break;
+	case ImageFileFormat::None:
+		break;
+	}
+	VERIFY(written, "Failed to write the rendered image!");
+}
@@ -0,0 +1,401 @@
+#include "Image.hpp"
+#include "File.hpp"
+
+static bool EndsWith(StringView string, StringView suffix)
+{
+	if (suffix.GetLength() > string.GetLength())
+	{
+		return false;
+	}
+
+	const usize offset = string.GetLength() - suffix.GetLength();
+	for (usize i = 0; i < suffix.GetLength(); ++i)
+	{
+		const char c = string[offset + i];
+		const char lower = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+		if (lower != suffix[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void AppendBytes(Array<uint8>* output, const void* data, usize size)
+{
+	const usize offset = output->GetLength();
+	output->GrowToLengthUninitialized(offset + size);
+	Platform::MemoryCopy(output->GetData() + offset, data, size);
+}
+
+static void AppendUint32BigEndian(Array<uint8>* output, uint32 value)
+{
+	const uint8 bytes[] = { static_cast<uint8>(value >> 24), static_cast<uint8>(value >> 16), static_cast<uint8>(value >> 8), static_cast<uint8>(value) };
+	AppendBytes(output, bytes, sizeof(bytes));
+}
+
+static void AppendLittleEndian(Array<uint8>* output, uint64 value, usize size)
+{
+	for (usize i = 0; i < size; ++i)
+	{
+		output->Add(static_cast<uint8>(value >> (i * 8)));
+	}
+}
+
+static void AppendString(Array<uint8>* output, StringView string)
+{
+	AppendBytes(output, string.GetData(), string.GetLength());
+	output->Add('\0');
+}
+
+static uint32 Crc32(const uint8* data, usize size, uint32 crc = 0)
+{
+	static uint32 table[256] = {};
+	if (table[1] == 0)
+	{
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			uint32 c = i;
+			for (usize bit = 0; bit < 8; ++bit)
+			{
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			}
+			table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	for (usize i = 0; i < size; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static uint32 Adler32(const uint8* data, usize size)
+{
+	static constexpr uint32 modulus = 65521;
+
+	uint32 a = 1;
+	uint32 b = 0;
+	for (usize i = 0; i < size; ++i)
+	{
+		a = (a + data[i]) % modulus;
+		b = (b + a) % modulus;
+	}
+	return (b << 16) | a;
+}
+
+static void AppendPngChunk(Array<uint8>* output, const char type[4], const uint8* data, usize size)
+{
+	AppendUint32BigEndian(output, static_cast<uint32>(size));
+
+	const usize typeOffset = output->GetLength();
+	AppendBytes(output, type, 4);
+	AppendBytes(output, data, size);
+
+	AppendUint32BigEndian(output, Crc32(output->GetData() + typeOffset, size + 4));
+}
+
+static bool IsPfmWhitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool ParsePfmToken(StringView file, usize* offset, StringView* token)
+{
+	usize start = *offset;
+	while (start < file.GetLength() && IsPfmWhitespace(file[start]))
+	{
+		++start;
+	}
+	usize end = start;
+	while (end < file.GetLength() && !IsPfmWhitespace(file[end]))
+	{
+		++end;
+	}
+	*token = StringView { file.GetData() + start, end - start };
+	*offset = end;
+	return end != start;
+}
+
+static bool ParsePfmDimension(StringView token, uint32* value)
+{
+	uint64 result = 0;
+	for (usize i = 0; i < token.GetLength(); ++i)
+	{
+		if (token[i] < '0' || token[i] > '9')
+		{
+			return false;
+		}
+		result = result * 10 + static_cast<uint64>(token[i] - '0');
+		if (result > 0xFFFF)
+		{
+			return false;
+		}
+	}
+	*value = static_cast<uint32>(result);
+	return result != 0;
+}
+
+ImageFileFormat GetImageFileFormat(StringView filePath)
+{
+	if (EndsWith(filePath, ".png"_view))
+	{
+		return ImageFileFormat::Png;
+	}
+	if (EndsWith(filePath, ".exr"_view))
+	{
+		return ImageFileFormat::OpenExr;
+	}
+	if (EndsWith(filePath, ".pfm"_view))
+	{
+		return ImageFileFormat::Pfm;
+	}
+	return ImageFileFormat::None;
+}
+
+bool WritePngImage(StringView filePath, const uint8* rgba, uint32 width, uint32 height)
+{
+	CHECK(rgba);
+
+	static constexpr uint8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	Array<uint8> file(&GlobalAllocator::Get());
+	AppendBytes(&file, signature, sizeof(signature));
+
+	Array<uint8> header(&GlobalAllocator::Get());
+	AppendUint32BigEndian(&header, width);
+	AppendUint32BigEndian(&header, height);
+	static constexpr uint8 bitDepth = 8;
+	static constexpr uint8 colorTypeRgba = 6;
+	const uint8 headerRest[] = { bitDepth, colorTypeRgba, 0, 0, 0 };
+	AppendBytes(&header, headerRest, sizeof(headerRest));
+	AppendPngChunk(&file, "IHDR", header.GetData(), header.GetLength());
+
+	// Every row starts with filter type 0 (none).
+	const usize rowSize = static_cast<usize>(width) * 4;
+	Array<uint8> scanlines(&GlobalAllocator::Get());
+	for (uint32 y = 0; y < height; ++y)
+	{
+		scanlines.Add(0);
+		AppendBytes(&scanlines, rgba + y * rowSize, rowSize);
+	}
+
+	// Uncompressed deflate blocks keep the writer small, the size is the same as the raw framebuffer.
+	static constexpr usize maxStoredBlockSize = 65535;
+	static constexpr uint8 zlibHeader[] = { 0x78, 0x01 };
+
+	Array<uint8> compressed(&GlobalAllocator::Get());
+	AppendBytes(&compressed, zlibHeader, sizeof(zlibHeader));
+	usize offset = 0;
+	do
+	{
+		const usize blockSize = Min(scanlines.GetLength() - offset, maxStoredBlockSize);
+		const bool isFinal = offset + blockSize == scanlines.GetLength();
+
+		compressed.Add(isFinal ? 1 : 0);
+		AppendLittleEndian(&compressed, blockSize, 2);
+		AppendLittleEndian(&compressed, ~blockSize & 0xFFFF, 2);
+		AppendBytes(&compressed, scanlines.GetData() + offset, blockSize);
+
+		offset += blockSize;
+	}
+	while (offset < scanlines.GetLength());
+	AppendUint32BigEndian(&compressed, Adler32(scanlines.GetData(), scanlines.GetLength()));
+
+	AppendPngChunk(&file, "IDAT", compressed.GetData(), compressed.GetLength());
+	AppendPngChunk(&file, "IEND", nullptr, 0);
+
+	return WriteEntireFile(filePath, file.GetData(), file.GetLength());
+}
+
+bool WriteOpenExrImage(StringView filePath, const Float3* pixels, uint32 width, uint32 height)
+{
+	CHECK(pixels);
+
+	static constexpr uint32 magic = 20000630;
+	static constexpr uint32 version = 2;
+
+	static constexpr uint32 pixelTypeFloat = 2;
+
+	const auto appendAttribute = [](Array<uint8>* output, StringView name, StringView type, const Array<uint8>& value)
+	{
+		AppendString(output, name);
+		AppendString(output, type);
+		AppendLittleEndian(output, value.GetLength(), sizeof(uint32));
+		AppendBytes(output, value.GetData(), value.GetLength());
+	};
+
+	Array<uint8> file(&GlobalAllocator::Get());
+	AppendLittleEndian(&file, magic, sizeof(uint32));
+	AppendLittleEndian(&file, version, sizeof(uint32));
+
+	// Channels must be listed alphabetically and pixel data follows the same order.
+	const StringView channelNames[] = { "B"_view, "G"_view, "R"_view };
+
+	Array<uint8> channels(&GlobalAllocator::Get());
+	for (const StringView name : channelNames)
+	{
+		AppendString(&channels, name);
+		AppendLittleEndian(&channels, pixelTypeFloat, sizeof(uint32));
+		AppendLittleEndian(&channels, 0, sizeof(uint32));
+		AppendLittleEndian(&channels, 1, sizeof(int32));
+		AppendLittleEndian(&channels, 1, sizeof(int32));
+	}
+	channels.Add('\0');
+	appendAttribute(&file, "channels"_view, "chlist"_view, channels);
+
+	Array<uint8> value(&GlobalAllocator::Get());
+	value.Add(0);
+	appendAttribute(&file, "compression"_view, "compression"_view, value);
+
+	value.Clear();
+	AppendLittleEndian(&value, 0, sizeof(int32));
+	AppendLittleEndian(&value, 0, sizeof(int32));
+	AppendLittleEndian(&value, width - 1, sizeof(int32));
+	AppendLittleEndian(&value, height - 1, sizeof(int32));
+	appendAttribute(&file, "dataWindow"_view, "box2i"_view, value);
+	appendAttribute(&file, "displayWindow"_view, "box2i"_view, value);
+
+	value.Clear();
+	value.Add(0);
+	appendAttribute(&file, "lineOrder"_view, "lineOrder"_view, value);
+
+	const float one = 1.0f;
+	const float zero[2] = { 0.0f, 0.0f };
+
+	value.Clear();
+	AppendBytes(&value, &one, sizeof(one));
+	appendAttribute(&file, "pixelAspectRatio"_view, "float"_view, value);
+	appendAttribute(&file, "screenWindowWidth"_view, "float"_view, value);
+
+	value.Clear();
+	AppendBytes(&value, zero, sizeof(zero));
+	appendAttribute(&file, "screenWindowCenter"_view, "v2f"_view, value);
+
+	file.Add('\0');
+
+	// One scanline per block: a table of absolute block offsets, then the y coordinate, size and planar channel data.
+	const usize channelRowSize = static_cast<usize>(width) * sizeof(float);
+	const usize blockDataSize = channelRowSize * 3;
+	const usize blockSize = sizeof(int32) + sizeof(uint32) + blockDataSize;
+	const usize firstBlockOffset = file.GetLength() + static_cast<usize>(height) * sizeof(uint64);
+	for (uint32 y = 0; y < height; ++y)
+	{
+		AppendLittleEndian(&file, firstBlockOffset + y * blockSize, sizeof(uint64));
+	}
+
+	Array<float> row(&GlobalAllocator::Get());
+	row.GrowToLengthUninitialized(static_cast<usize>(width) * 3);
+	for (uint32 y = 0; y < height; ++y)
+	{
+		for (uint32 x = 0; x < width; ++x)
+		{
+			const Float3& pixel = pixels[static_cast<usize>(y) * width + x];
+			row[x + width * 0] = pixel.Z;
+			row[x + width * 1] = pixel.Y;
+			row[x + width * 2] = pixel.X;
+		}
+
+		AppendLittleEndian(&file, y, sizeof(int32));
+		AppendLittleEndian(&file, blockDataSize, sizeof(uint32));
+		AppendBytes(&file, row.GetData(), blockDataSize);
+	}
+
+	return WriteEntireFile(filePath, file.GetData(), file.GetLength());
+}
+
+bool WritePfmImage(StringView filePath, const Float3* pixels, uint32 width, uint32 height)
+{
+	CHECK(pixels);
+
+	char header[64] = {};
+	Platform::StringPrint("PF\n%u %u\n-1.0\n", header, sizeof(header), width, height);
+	const usize headerSize = Platform::StringLength(header);
+
+	const usize rowSize = static_cast<usize>(width) * sizeof(Float3);
+
+	Array<uint8> file(&GlobalAllocator::Get());
+	AppendBytes(&file, header, headerSize);
+
+	// PFM stores rows bottom to top and a negative scale marks little-endian floats.
+	for (uint32 y = 0; y < height; ++y)
+	{
+		const Float3* row = pixels + static_cast<usize>(height - 1 - y) * width;
+		AppendBytes(&file, row, rowSize);
+	}
+
+	return WriteEntireFile(filePath, file.GetData(), file.GetLength());
+}
+
+bool ReadPfmImage(StringView filePath, Array<Float3>* pixels, uint32* width, uint32* height)
+{
+	CHECK(pixels);
+	CHECK(width);
+	CHECK(height);
+
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		return false;
+	}
+	const StringView view = file.GetView();
+
+	usize offset = 0;
+	StringView type;
+	StringView widthToken;
+	StringView heightToken;
+	StringView scaleToken;
+	if (!ParsePfmToken(view, &offset, &type) || !ParsePfmToken(view, &offset, &widthToken) ||
+		!ParsePfmToken(view, &offset, &heightToken) || !ParsePfmToken(view, &offset, &scaleToken))
+	{
+		return false;
+	}
+
+	const bool isColor = type == "PF"_view;
+	if (!isColor && type != "Pf"_view)
+	{
+		return false;
+	}
+	if (!ParsePfmDimension(widthToken, width) || !ParsePfmDimension(heightToken, height))
+	{
+		return false;
+	}
+
+	// A single whitespace character separates the scale from the pixels, and its sign gives their byte order.
+	const usize dataOffset = offset + 1;
+	const bool isBigEndian = scaleToken[0] != '-';
+	const usize channelCount = isColor ? 3 : 1;
+	const usize rowSize = static_cast<usize>(*width) * channelCount * sizeof(float);
+	if (dataOffset > view.GetLength() || view.GetLength() - dataOffset < rowSize * *height)
+	{
+		return false;
+	}
+
+	pixels->Clear();
+	pixels->GrowToLengthUninitialized(static_cast<usize>(*width) * *height);
+
+	for (uint32 y = 0; y < *height; ++y)
+	{
+		const uint8* row = file.GetData() + dataOffset + static_cast<usize>(*height - 1 - y) * rowSize;
+		Float3* output = pixels->GetData() + static_cast<usize>(y) * *width;
+		for (uint32 x = 0; x < *width; ++x)
+		{
+			float channels[3];
+			for (usize channel = 0; channel < channelCount; ++channel)
+			{
+				uint8 bytes[sizeof(float)];
+				Platform::MemoryCopy(bytes, row + (x * channelCount + channel) * sizeof(float), sizeof(float));
+				if (isBigEndian)
+				{
+					const uint8 swapped[] = { bytes[3], bytes[2], bytes[1], bytes[0] };
+					Platform::MemoryCopy(bytes, swapped, sizeof(float));
+				}
+				Platform::MemoryCopy(&channels[channel], bytes, sizeof(float));
+			}
+			output[x] = isColor ? Float3 { channels[0], channels[1], channels[2] } : Float3 { channels[0], channels[0], channels[0] };
+		}
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Luft/Array.hpp"
+#include "Luft/Math.hpp"
+#include "Luft/String.hpp"
+
+enum class ImageFileFormat
+{
+	None,
+	Png,
+	OpenExr,
+	Pfm,
+};
+
+ImageFileFormat GetImageFileFormat(StringView filePath);
+
+bool WritePngImage(StringView filePath, const uint8* rgba, uint32 width, uint32 height);
+bool WriteOpenExrImage(StringView filePath, const Float3* pixels, uint32 width, uint32 height);
+bool WritePfmImage(StringView filePath, const Float3* pixels, uint32 width, uint32 height);
+
+// Reads color and grayscale PFM files of either byte order into top-to-bottom rows. Returns false for a missing or
+// malformed file.
+bool ReadPfmImage(StringView filePath, Array<Float3>* pixels, uint32* width, uint32* height);
@@ -1,9 +1,21 @@
 ﻿#include "JSON.hpp"
+#include "Decimal.hpp"
+#include "File.hpp"
+#include "ThreadPool.hpp"
 
 #include "Luft/Math.hpp"
 
-static JsonArray ParseJsonArray(StringView buffer, usize* index);
-static JsonObject ParseJsonObject(StringView buffer, usize* index);
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static JsonArray ParseJsonArray(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas);
+static JsonObject ParseJsonObject(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas);
 
 static Allocator* JsonAllocator = &GlobalAllocator::Get();
 
@@ -20,7 +32,10 @@ JsonValue::~JsonValue()
 		ArrayValue.~Array();
 		break;
 	case JsonTag::String:
-		StringValue.~String();
+		if (!IsStringView)
+		{
+			StringValue.~String();
+		}
 		break;
 	case JsonTag::Decimal:
 		DecimalValue = 0.0;
@@ -39,6 +54,7 @@ JsonValue::~JsonValue()
 
 JsonValue::JsonValue(const JsonValue& copy)
 	: Tag(copy.Tag)
+	, IsStringView(copy.IsStringView)
 {
 	switch (Tag)
 	{
@@ -49,7 +65,14 @@ JsonValue::JsonValue(const JsonValue& copy)
 		ArrayValue = copy.ArrayValue;
 		break;
 	case JsonTag::String:
-		StringValue = copy.StringValue;
+		if (IsStringView)
+		{
+			StringViewValue = copy.StringViewValue;
+		}
+		else
+		{
+			StringValue = copy.StringValue;
+		}
 		break;
 	case JsonTag::Decimal:
 		DecimalValue = copy.DecimalValue;
@@ -70,6 +93,7 @@ JsonValue& JsonValue::operator=(const JsonValue& copy)
 	CHECK(&copy != this);
 
 	Tag = copy.Tag;
+	IsStringView = copy.IsStringView;
 
 	switch (Tag)
 	{
@@ -80,7 +104,14 @@ JsonValue& JsonValue::operator=(const JsonValue& copy)
 		ArrayValue = copy.ArrayValue;
 		break;
 	case JsonTag::String:
-		StringValue = copy.StringValue;
+		if (IsStringView)
+		{
+			StringViewValue = copy.StringViewValue;
+		}
+		else
+		{
+			StringValue = copy.StringValue;
+		}
 		break;
 	case JsonTag::Decimal:
 		DecimalValue = copy.DecimalValue;
@@ -100,6 +131,7 @@ JsonValue& JsonValue::operator=(const JsonValue& copy)
 
 JsonValue::JsonValue(JsonValue&& move)
 	: Tag(move.Tag)
+	, IsStringView(move.IsStringView)
 {
 	move.Tag = JsonTag::None;
 
@@ -113,7 +145,14 @@ JsonValue::JsonValue(JsonValue&& move)
 		new (&ArrayValue, LuftNewMarker {}) JsonArray { Move(move.ArrayValue) };
 		break;
 	case JsonTag::String:
-		new (&StringValue, LuftNewMarker {}) String { Move(move.StringValue) };
+		if (IsStringView)
+		{
+			StringViewValue = move.StringViewValue;
+		}
+		else
+		{
+			new (&StringValue, LuftNewMarker {}) String { Move(move.StringValue) };
+		}
 		break;
 	case JsonTag::Decimal:
 		DecimalValue = move.DecimalValue;
@@ -139,6 +178,7 @@ JsonValue& JsonValue::operator=(JsonValue&& move)
 	this->~JsonValue();
 
 	Tag = move.Tag;
+	IsStringView = move.IsStringView;
 	move.Tag = JsonTag::None;
 
 	switch (Tag)
@@ -148,10 +188,17 @@ JsonValue& JsonValue::operator=(JsonValue&& move)
 		move.ObjectValue = nullptr;
 		break;
 	case JsonTag::Array:
-		ArrayValue = Move(move.ArrayValue);
+		new (&ArrayValue, LuftNewMarker {}) JsonArray { Move(move.ArrayValue) };
 		break;
 	case JsonTag::String:
-		StringValue = Move(move.StringValue);
+		if (IsStringView)
+		{
+			StringViewValue = move.StringViewValue;
+		}
+		else
+		{
+			new (&StringValue, LuftNewMarker {}) String { Move(move.StringValue) };
+		}
 		break;
 	case JsonTag::Decimal:
 		DecimalValue = move.DecimalValue;
@@ -193,114 +240,328 @@ static bool IsInRange(StringView buffer, usize index, usize count = 0)
 	return index + count < buffer.GetLength();
 }
 
-static void SkipWhitespace(StringView buffer, usize* index)
+static constexpr usize StructuralBlockSize = 64;
+// How much of the buffer the structural index scans at a time, a whole number of blocks.
+static constexpr usize StructuralWindowSize = 64 * 1024;
+
+// One bit per byte of a block for each class of character the structural scan cares about.
+struct StructuralBlockMasks
 {
-	CHECK(index);
-	while (IsInRange(buffer, *index) && IsSpace(buffer[*index]))
+	uint64 Quote;
+	uint64 Backslash;
+	uint64 Whitespace;
+	uint64 Operator;
+};
+
+#if defined(__AVX2__)
+static uint64 CombineMasks(__m256i low, __m256i high)
+{
+	const uint64 lowBits = static_cast<uint32>(_mm256_movemask_epi8(low));
+	const uint64 highBits = static_cast<uint32>(_mm256_movemask_epi8(high));
+	return lowBits | (highBits << 32);
+}
+
+static StructuralBlockMasks ClassifyBlock(const char* block)
+{
+	// Both tables are indexed by the low nibble and hold the one character with that nibble that belongs to the class, so a
+	// byte is in the class exactly when the lookup gives the byte back. Setting bit 5 folds the brackets onto the braces.
+	const __m256i whitespaceTable = _mm256_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0,
+													 ' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+	const __m256i operatorTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+												   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+	const __m256i caseBit = _mm256_set1_epi8(0x20);
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+
+	const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+	const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+	const __m256i lowFolded = _mm256_or_si256(low, caseBit);
+	const __m256i highFolded = _mm256_or_si256(high, caseBit);
+
+	StructuralBlockMasks masks;
+	masks.Quote = CombineMasks(_mm256_cmpeq_epi8(low, quote), _mm256_cmpeq_epi8(high, quote));
+	masks.Backslash = CombineMasks(_mm256_cmpeq_epi8(low, backslash), _mm256_cmpeq_epi8(high, backslash));
+	masks.Whitespace = CombineMasks(_mm256_cmpeq_epi8(low, _mm256_shuffle_epi8(whitespaceTable, low)),
+									_mm256_cmpeq_epi8(high, _mm256_shuffle_epi8(whitespaceTable, high)));
+	masks.Operator = CombineMasks(_mm256_cmpeq_epi8(lowFolded, _mm256_shuffle_epi8(operatorTable, lowFolded)),
+								  _mm256_cmpeq_epi8(highFolded, _mm256_shuffle_epi8(operatorTable, highFolded)));
+	return masks;
+}
+#else
+static StructuralBlockMasks ClassifyBlock(const char* block)
+{
+	StructuralBlockMasks masks = {};
+	for (usize i = 0; i < StructuralBlockSize; ++i)
 	{
-		*index += 1;
+		const char c = block[i];
+		const uint64 bit = 1ULL << i;
+		masks.Quote |= (c == '"') ? bit : 0;
+		masks.Backslash |= (c == '\\') ? bit : 0;
+		masks.Whitespace |= IsSpace(c) ? bit : 0;
+		masks.Operator |= (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') ? bit : 0;
 	}
+	return masks;
 }
+#endif
 
-static char PeekCharacter(StringView buffer, usize index)
+static uint32 CountTrailingZeros(uint64 mask)
 {
-	VERIFY(IsInRange(buffer, index), "Failed to read character!");
-	return buffer[index];
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return static_cast<uint32>(index);
+#else
+	return static_cast<uint32>(__builtin_ctzll(mask));
+#endif
 }
 
-static void ExpectCharacter(StringView buffer, usize* index, char c)
+static uint32 PopCount(uint64 mask)
 {
-	CHECK(index);
-	VERIFY(IsInRange(buffer, *index) && buffer[*index] == c, "Failed to parse expected character!");
-	Advance(index, 1);
+#if defined(_MSC_VER)
+	return static_cast<uint32>(__popcnt64(mask));
+#else
+	return static_cast<uint32>(__builtin_popcountll(mask));
+#endif
 }
 
-static void ExpectString(StringView buffer, usize* index, StringView expect)
+// Bit i of the result is the XOR of bits 0 to i, which turns the quote bits into the bits inside strings.
+static uint64 PrefixXor(uint64 mask)
 {
-	for (usize i = 0; i < expect.GetLength(); ++i)
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	mask ^= mask << 16;
+	mask ^= mask << 32;
+	return mask;
+}
+
+// Returns the characters escaped by a backslash. A run of backslashes escapes the character after it only when the run has
+// odd length, which adding the runs that start on odd bits to the backslashes sorts out without a loop.
+static uint64 FindEscaped(uint64 backslash, uint64* previousEscaped)
+{
+	static constexpr uint64 evenBits = 0x5555555555555555ULL;
+
+	backslash &= ~*previousEscaped;
+	const uint64 followsEscape = (backslash << 1) | *previousEscaped;
+	const uint64 oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+	const uint64 sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+	*previousEscaped = (sequencesStartingOnEvenBits < oddSequenceStarts) ? 1 : 0;
+
+	const uint64 invertMask = sequencesStartingOnEvenBits << 1;
+	return (evenBits ^ invertMask) & followsEscape;
+}
+
+JsonStructuralIndex::JsonStructuralIndex(StringView buffer, usize start)
+	: Buffer(buffer)
+	, ScanOffset(start)
+	, PreviousEscaped(0)
+	, PreviousInString(0)
+	, PreviousScalar(0)
+	, Offsets()
+	, TokenCount(0)
+	, Next(0)
+	, Window { start, 0, 0, 0, 0 }
+{
+	VERIFY(buffer.GetLength() <= 0xFFFFFFFF, "JSON file is too large to index!");
+	CHECK(start <= buffer.GetLength());
+}
+
+void JsonStructuralIndex::ScanWindow()
+{
+	const usize windowEnd = Min(ScanOffset + StructuralWindowSize, Buffer.GetLength());
+
+	Window = { ScanOffset, PreviousEscaped, PreviousInString, PreviousScalar, 0 };
+	TokenCount = 0;
+	Next = 0;
+	for (usize blockStart = ScanOffset; blockStart < windowEnd; blockStart += StructuralBlockSize)
 	{
-		ExpectCharacter(buffer, index, expect[i]);
+		const usize remaining = Buffer.GetLength() - blockStart;
+
+		// The last block is padded with whitespace, which never starts a token.
+		char padded[StructuralBlockSize];
+		const char* block = Buffer.GetData() + blockStart;
+		if (remaining < StructuralBlockSize)
+		{
+			Platform::MemorySet(padded, ' ', sizeof(padded));
+			Platform::MemoryCopy(padded, block, remaining);
+			block = padded;
+		}
+
+		const StructuralBlockMasks masks = ClassifyBlock(block);
+
+		const uint64 escaped = FindEscaped(masks.Backslash, &PreviousEscaped);
+		const uint64 quote = masks.Quote & ~escaped;
+		const uint64 inString = PrefixXor(quote) ^ PreviousInString;
+		PreviousInString = static_cast<uint64>(static_cast<int64>(inString) >> 63);
+
+		// Numbers and literals start wherever a run of other characters follows whitespace, an operator or a closing quote.
+		const uint64 scalar = ~(masks.Operator | masks.Whitespace);
+		const uint64 nonQuoteScalar = scalar & ~quote;
+		const uint64 followsNonQuoteScalar = (nonQuoteScalar << 1) | PreviousScalar;
+		PreviousScalar = nonQuoteScalar >> 63;
+		const uint64 scalarStart = scalar & ~followsNonQuoteScalar;
+
+		// In the string mask the opening quote is set and the closing one is not, so this drops everything inside strings
+		// and then puts both quotes back.
+		uint64 tokens = ((masks.Operator | scalarStart) & ~(inString ^ quote)) | quote;
+
+		// Growing ahead of a whole block keeps the extraction loop free of capacity checks. A window has at most one token
+		// per byte, which bounds the growth.
+		if (TokenCount + StructuralBlockSize > Offsets.GetLength())
+		{
+			Offsets.GrowToLengthUninitialized(Min(Offsets.GetLength() * 2 + StructuralBlockSize, StructuralWindowSize + StructuralBlockSize));
+		}
+		// Offsets are written four at a time whether or not there are that many tokens left, the spare writes land past
+		// the count and are overwritten by the next block. That keeps the branch predictable for dense blocks.
+		uint32* offsets = Offsets.GetData() + TokenCount;
+		const usize blockTokenCount = PopCount(tokens);
+		for (usize i = 0; i < blockTokenCount; i += 4)
+		{
+			for (usize j = 0; j < 4; ++j)
+			{
+				offsets[i + j] = static_cast<uint32>(blockStart + CountTrailingZeros(tokens | (1ULL << 63)));
+				tokens &= tokens - 1;
+			}
+		}
+		TokenCount += blockTokenCount;
 	}
+	ScanOffset = windowEnd;
 }
 
-static uint64 ParseUint64(StringView buffer, usize* index)
+JsonStructuralIndex::Mark JsonStructuralIndex::GetMark() const
 {
-	CHECK(index);
-	usize offset = 0;
-	uint64 factor = 1;
-	while (IsInRange(buffer, *index + offset) && IsDigit(buffer[*index + offset]))
+	Mark mark = Window;
+	mark.Next = Next;
+	return mark;
+}
+
+void JsonStructuralIndex::Rewind(const Mark& mark)
+{
+	if (mark.WindowStart != Window.WindowStart)
 	{
-		++offset;
-		factor *= 10;
+		ScanOffset = mark.WindowStart;
+		PreviousEscaped = mark.PreviousEscaped;
+		PreviousInString = mark.PreviousInString;
+		PreviousScalar = mark.PreviousScalar;
+		ScanWindow();
 	}
-	VERIFY(offset != 0, "Expected to read a number and failed!");
+	Next = mark.Next;
+}
 
-	uint64 result = 0;
-	for (usize i = 0; i < offset; ++i)
+usize JsonStructuralIndex::GetToken()
+{
+	// A window inside a long string or a run of whitespace can hold no tokens at all.
+	while (Next == TokenCount && ScanOffset < Buffer.GetLength())
 	{
-		factor /= 10;
-		result += factor * (PeekCharacter(buffer, *index + i) - '0');
+		ScanWindow();
 	}
+	return (Next < TokenCount) ? Offsets[Next] : Buffer.GetLength();
+}
 
-	*index += offset;
-	return result;
+usize JsonStructuralIndex::SeekToken(usize offset)
+{
+	usize token = GetToken();
+	while (token < offset)
+	{
+		++Next;
+		token = GetToken();
+	}
+	return token;
 }
 
-static int64 ParseInt64(StringView buffer, usize* index)
+void JsonStructuralIndex::SkipToToken(usize* index)
 {
 	CHECK(index);
-	const bool isNegative = PeekCharacter(buffer, *index) == '-';
-	const bool isSign = isNegative || PeekCharacter(buffer, *index) == '+';
-	VERIFY(IsDigit(buffer[*index]) || isSign, "Expected to read a number and failed!");
 
-	if (isSign)
+	// Compact files rarely have whitespace between tokens, and a stray character after a value is left for the parser to
+	// reject, so the index is only consulted when there is something to skip.
+	if (*index >= Buffer.GetLength() || !IsSpace(Buffer[*index]))
 	{
-		Advance(index, 1);
+		return;
 	}
-	const int64 value = static_cast<int64>(ParseUint64(buffer, index));
-	return isNegative ? -value : value;
+
+	// Anything between the index and the next token has to be whitespace, or it would have started a token itself.
+	*index = SeekToken(*index);
 }
 
-static double ParseDoubleNoExponent(StringView buffer, usize* index)
+usize JsonStructuralIndex::FindClosingQuote(usize openingQuote)
 {
-	CHECK(index);
-	const bool isNegative = PeekCharacter(buffer, *index) == '-';
-	const int64 whole = ParseInt64(buffer, index);
+	VERIFY(SeekToken(openingQuote) == openingQuote, "Failed to parse expected character!");
+	++Next;
+	const usize closingQuote = GetToken();
+	VERIFY(closingQuote < Buffer.GetLength() && Buffer[closingQuote] == '"', "Failed to find the end of a string!");
+	return closingQuote;
+}
 
-	uint64 fractional = 0;
-	uint64 divisor = 1;
-	if (PeekCharacter(buffer, *index) == '.')
-	{
-		Advance(index, 1);
+usize JsonStructuralIndex::FindArrayElements(usize openingBracket, Array<uint32>* bounds)
+{
+	CHECK(bounds);
 
-		if (IsInRange(buffer, *index) && IsDigit(buffer[*index]))
-		{
-			const usize startingIndex = *index;
-			fractional = ParseUint64(buffer, index);
+	VERIFY(SeekToken(openingBracket) == openingBracket && Buffer[openingBracket] == '[', "Failed to parse expected character!");
+	bounds->Add(static_cast<uint32>(openingBracket));
 
-			usize fractionalLength = *index - startingIndex;
-			while (fractionalLength != 0)
+	++Next;
+	VERIFY(GetToken() < Buffer.GetLength(), "Failed to find the end of a JSON array!");
+	const bool isEmpty = Buffer[GetToken()] == ']';
+
+	// Strings are single tokens and scalars start with neither brackets nor commas, so only the structure is counted.
+	usize depth = 1;
+	for (usize token = GetToken(); token < Buffer.GetLength(); ++Next, token = GetToken())
+	{
+		const char c = Buffer[token];
+		if (c == '[' || c == '{')
+		{
+			++depth;
+		}
+		else if (c == ']' || c == '}')
+		{
+			--depth;
+			if (depth == 0)
 			{
-				divisor *= 10;
-				--fractionalLength;
+				bounds->Add(static_cast<uint32>(token));
+				return isEmpty ? 0 : bounds->GetLength() - 1;
 			}
 		}
+		else if (c == ',' && depth == 1)
+		{
+			bounds->Add(static_cast<uint32>(token));
+		}
 	}
+	VERIFY(false, "Failed to find the end of a JSON array!");
+	return 0;
+}
+
+static char PeekCharacter(StringView buffer, usize index)
+{
+	VERIFY(IsInRange(buffer, index), "Failed to read character!");
+	return buffer[index];
+}
+
+static void ExpectCharacter(StringView buffer, usize* index, char c)
+{
+	CHECK(index);
+	VERIFY(IsInRange(buffer, *index) && buffer[*index] == c, "Failed to parse expected character!");
+	Advance(index, 1);
+}
 
-	const float factor = isNegative ? -1.0f : 1.0f;
-	return static_cast<double>(whole) + factor * (static_cast<double>(fractional) / static_cast<double>(divisor));
+static void ExpectString(StringView buffer, usize* index, StringView expect)
+{
+	for (usize i = 0; i < expect.GetLength(); ++i)
+	{
+		ExpectCharacter(buffer, index, expect[i]);
+	}
 }
 
-static void ParseEscapeSequence(StringView buffer, usize* index, String* result)
+static void ParseEscapeSequence(StringView buffer, usize* index)
 {
-	const auto parseAnyOf = [](StringView buffer, usize* index, String* result, const char* any, usize anyLength) -> bool
+	const auto parseAnyOf = [](StringView buffer, usize* index, const char* any, usize anyLength) -> bool
 	{
 		CHECK(index);
 		for (usize i = 0; i < anyLength; ++i)
 		{
 			if (PeekCharacter(buffer, *index) == any[i])
 			{
-				result->Append(any[i]);
 				Advance(index, 1);
 				return true;
 			}
@@ -312,9 +573,8 @@ static void ParseEscapeSequence(StringView buffer, usize* index, String* result)
 	static constexpr char acceptableHex[] = "0123456789abcdefABCDEF";
 
 	ExpectCharacter(buffer, index, '\\');
-	result->Append('\\');
 
-	const bool matchedEscape = parseAnyOf(buffer, index, result, acceptableEscape, ARRAY_COUNT(acceptableEscape));
+	const bool matchedEscape = parseAnyOf(buffer, index, acceptableEscape, ARRAY_COUNT(acceptableEscape));
 	VERIFY(matchedEscape, "Failed to parse escape sequence!");
 
 	if (PeekCharacter(buffer, *index - 1) == 'u')
@@ -323,78 +583,187 @@ static void ParseEscapeSequence(StringView buffer, usize* index, String* result)
 		for (usize i = 0; i < codepointLength; ++i)
 		{
 			VERIFY(IsInRange(buffer, *index), "Failed to parse unicode codepoint!");
-			const bool matchedHex = parseAnyOf(buffer, index, result, acceptableHex, ARRAY_COUNT(acceptableHex));
+			const bool matchedHex = parseAnyOf(buffer, index, acceptableHex, ARRAY_COUNT(acceptableHex));
 			VERIFY(matchedHex, "Failed to parse unicode codepoint!");
 		}
 	}
 }
 
-static String ParseString(StringView buffer, usize* index)
+static StringView ParseStringView(StringView buffer, usize* index, JsonStructuralIndex* structurals)
 {
 	CHECK(index);
+	CHECK(structurals);
 
-	String result(16);
+	const usize end = structurals->FindClosingQuote(*index);
+	ExpectCharacter(buffer, index, '"');
+	const usize start = *index;
 
+	// The structural index already knows where the string ends, only the escape sequences inside it need checking.
+	const char* backslash = static_cast<const char*>(memchr(buffer.GetData() + start, '\\', end - start));
+	while (backslash)
+	{
+		*index = backslash - buffer.GetData();
+		ParseEscapeSequence(buffer, index);
+		backslash = static_cast<const char*>(memchr(buffer.GetData() + *index, '\\', end - *index));
+	}
+	*index = end;
+
+	const StringView result = { buffer.GetData() + start, end - start };
 	ExpectCharacter(buffer, index, '"');
-	while (PeekCharacter(buffer, *index) != '"')
+
+	return result;
+}
+
+static uint32 ParseHexQuad(StringView raw, usize start)
+{
+	uint32 value = 0;
+	for (usize i = start; i < start + 4; ++i)
+	{
+		const char c = raw[i];
+		const uint32 digit = IsDigit(c) ? static_cast<uint32>(c - '0') : static_cast<uint32>((c | 0x20) - 'a' + 10);
+		value = (value << 4) | digit;
+	}
+	return value;
+}
+
+// Decodes a string that ParseStringView has already validated. The output is never longer than the raw string.
+template<typename F>
+static void DecodeEscapes(StringView raw, const F& append)
+{
+	for (usize i = 0; i < raw.GetLength(); ++i)
 	{
-		const char c = buffer[*index];
-		if (c == '\\')
+		if (raw[i] != '\\')
 		{
-			ParseEscapeSequence(buffer, index, &result);
+			append(raw[i]);
+			continue;
 		}
-		else
+
+		const char escape = raw[++i];
+		switch (escape)
+		{
+		case 'b':
+			append('\b');
+			break;
+		case 'f':
+			append('\f');
+			break;
+		case 'n':
+			append('\n');
+			break;
+		case 'r':
+			append('\r');
+			break;
+		case 't':
+			append('\t');
+			break;
+		case 'u':
 		{
-			result.Append(c);
-			Advance(index, 1);
+			uint32 codepoint = ParseHexQuad(raw, i + 1);
+			i += 4;
+
+			const bool isHighSurrogate = codepoint >= 0xD800 && codepoint < 0xDC00;
+			if (isHighSurrogate && i + 6 < raw.GetLength() && raw[i + 1] == '\\' && raw[i + 2] == 'u')
+			{
+				const uint32 low = ParseHexQuad(raw, i + 3);
+				if (low >= 0xDC00 && low < 0xE000)
+				{
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+					i += 6;
+				}
+			}
+
+			if (codepoint < 0x80)
+			{
+				append(static_cast<char>(codepoint));
+			}
+			else if (codepoint < 0x800)
+			{
+				append(static_cast<char>(0xC0 | (codepoint >> 6)));
+				append(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+			else if (codepoint < 0x10000)
+			{
+				append(static_cast<char>(0xE0 | (codepoint >> 12)));
+				append(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+				append(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+			else
+			{
+				append(static_cast<char>(0xF0 | (codepoint >> 18)));
+				append(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+				append(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+				append(static_cast<char>(0x80 | (codepoint & 0x3F)));
+			}
+			break;
+		}
+		default:
+			append(escape);
+			break;
 		}
 	}
-	ExpectCharacter(buffer, index, '"');
+}
+
+static bool HasEscapes(StringView raw)
+{
+	return memchr(raw.GetData(), '\\', raw.GetLength()) != nullptr;
+}
 
+static String ParseString(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator)
+{
+	const StringView raw = ParseStringView(buffer, index, structurals);
+
+	String result(raw.GetLength(), allocator);
+	DecodeEscapes(raw, [&result](char c)
+	{
+		result.Append(c);
+	});
 	return result;
 }
 
-static double ParseJsonNumber(StringView buffer, usize* index)
+// Strings without escapes are returned as views into the buffer, only escaped ones are decoded into new memory.
+static StringView ParseStringInSitu(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator)
 {
-	const double mantissa = ParseDoubleNoExponent(buffer, index);
-	int64 exponent = 0;
-	if (PeekCharacter(buffer, *index) == 'e' || PeekCharacter(buffer, *index) == 'E')
+	const StringView raw = ParseStringView(buffer, index, structurals);
+	if (!HasEscapes(raw))
 	{
-		Advance(index, 1);
-		exponent = ParseInt64(buffer, index);
+		return raw;
 	}
 
-	const double power = static_cast<double>(Power10(Absolute(exponent)));
-	const double multiplier = (exponent >= 0) ? power : (1.0 / power);
-	return mantissa * multiplier;
+	char* decoded = static_cast<char*>(allocator->Allocate(raw.GetLength()));
+	usize length = 0;
+	DecodeEscapes(raw, [decoded, &length](char c)
+	{
+		decoded[length++] = c;
+	});
+	return StringView { decoded, length };
 }
 
-static JsonValue ParseJsonValue(StringView buffer, usize* index)
+static JsonValue ParseJsonValue(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas)
 {
 	CHECK(index);
 
-	SkipWhitespace(buffer, index);
+	structurals->SkipToToken(index);
 
 	JsonValue value = {};
 
 	const char leading = PeekCharacter(buffer, *index);
 	if (leading == '"')
 	{
-		value = JsonValue { ParseString(buffer, index) };
+		value = inSitu ? JsonValue { ParseStringInSitu(buffer, index, structurals, allocator) } : JsonValue { ParseString(buffer, index, structurals, allocator) };
 	}
 	else if (IsDigit(leading) || leading == '-' || leading == '+')
 	{
-		value = JsonValue { ParseJsonNumber(buffer, index) };
+		value = JsonValue { ParseDecimal(buffer, index) };
 	}
 	else if (leading == '{')
 	{
-		JsonObject* object = JsonAllocator->Create<JsonObject>(ParseJsonObject(buffer, index));
+		JsonObject* object = allocator->Create<JsonObject>(ParseJsonObject(buffer, index, structurals, allocator, inSitu, chunkArenas));
 
 		value = JsonValue { object };
 	}
 	else if (leading == '[')
 	{
-		value = JsonValue { ParseJsonArray(buffer, index) };
+		value = JsonValue { ParseJsonArray(buffer, index, structurals, allocator, inSitu, chunkArenas) };
 	}
 	else if (leading == 't')
 	{
@@ -418,28 +787,113 @@ static JsonValue ParseJsonValue(StringView buffer, usize* index)
 	{
 		VERIFY(false, "Failed to parse JSON value!");
 	}
-	SkipWhitespace(buffer, index);
+	structurals->SkipToToken(index);
 
 	return value;
 }
 
-static JsonArray ParseJsonArray(StringView buffer, usize* index)
+// Finds where each element starts from the structural index alone, then parses runs of elements on the thread pool, each
+// run with its own index from where it starts and its own arena, and moves the results into one array in order. Arrays too
+// small to be worth it are parsed serially with the caller's index, and so is everything inside them and inside a run.
+static JsonArray ParseJsonArrayInChunks(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas)
+{
+	static constexpr usize minimumParallelSize = 256 * 1024;
+	static constexpr usize minimumChunkLength = 256;
+
+	// An array that starts this close to the end is too small to split without having to find its end first.
+	if (buffer.GetLength() - *index < minimumParallelSize)
+	{
+		return ParseJsonArray(buffer, index, structurals, allocator, inSitu, nullptr);
+	}
+
+	const JsonStructuralIndex::Mark openingBracket = structurals->GetMark();
+	Array<uint32> bounds(JsonAllocator);
+	const usize elementCount = structurals->FindArrayElements(*index, &bounds);
+	const usize closingBracket = bounds[bounds.GetLength() - 1];
+
+	ThreadPool& threadPool = ThreadPool::Get();
+	const bool isLarge = closingBracket - *index >= minimumParallelSize && elementCount >= 2 * minimumChunkLength;
+	if (!isLarge)
+	{
+		structurals->Rewind(openingBracket);
+		return ParseJsonArray(buffer, index, structurals, allocator, inSitu, nullptr);
+	}
+	const usize chunkCount = Min(elementCount / minimumChunkLength, threadPool.GetThreadCount() * 4);
+
+	const auto parseRun = [buffer, inSitu, &bounds](usize first, usize last, Allocator* runAllocator, JsonArray* results)
+	{
+		if (first == last)
+		{
+			return;
+		}
+
+		// Just past a bracket or a comma is never inside a value, so a run can index from there on its own.
+		usize runIndex = bounds[first] + 1;
+		JsonStructuralIndex reader(buffer, runIndex);
+		for (usize element = first; element < last; ++element)
+		{
+			if (element != first)
+			{
+				ExpectCharacter(buffer, &runIndex, ',');
+			}
+			results->Add(ParseJsonValue(buffer, &runIndex, &reader, runAllocator, inSitu, nullptr));
+		}
+
+		// Every run has to stop on the separator the next one starts after, or on the closing bracket.
+		VERIFY(runIndex == bounds[last], "Failed to parse JSON array!");
+	};
+
+	Array<ArenaAllocator*> arenas(JsonAllocator);
+	Array<JsonArray> chunks(JsonAllocator);
+	for (usize chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		ArenaAllocator* arena = JsonAllocator->Create<ArenaAllocator>();
+		chunkArenas->Add(arena);
+		arenas.Add(arena);
+		chunks.Emplace(arena);
+	}
+
+	threadPool.ParallelFor(chunkCount, [&](usize chunk, usize)
+	{
+		parseRun(elementCount * chunk / chunkCount, elementCount * (chunk + 1) / chunkCount, arenas[chunk], &chunks[chunk]);
+	});
+
+	JsonArray array { allocator };
+	for (JsonArray& chunk : chunks)
+	{
+		for (JsonValue& value : chunk)
+		{
+			array.Add(Move(value));
+		}
+	}
+
+	*index = closingBracket;
+	ExpectCharacter(buffer, index, ']');
+	return array;
+}
+
+static JsonArray ParseJsonArray(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas)
 {
 	CHECK(index);
 
+	if (chunkArenas)
+	{
+		return ParseJsonArrayInChunks(buffer, index, structurals, allocator, inSitu, chunkArenas);
+	}
+
 	ExpectCharacter(buffer, index, '[');
-	SkipWhitespace(buffer, index);
+	structurals->SkipToToken(index);
 
 	if (PeekCharacter(buffer, *index) == ']')
 	{
 		Advance(index, 1);
-		return JsonArray { JsonAllocator };
+		return JsonArray { allocator };
 	}
 
-	JsonArray array { JsonAllocator };
+	JsonArray array { allocator };
 	while (IsInRange(buffer, *index))
 	{
-		array.Add(ParseJsonValue(buffer, index));
+		array.Add(ParseJsonValue(buffer, index, structurals, allocator, inSitu, chunkArenas));
 
 		if (PeekCharacter(buffer, *index) != ',')
 		{
@@ -452,29 +906,40 @@ static JsonArray ParseJsonArray(StringView buffer, usize* index)
 	return array;
 }
 
-static JsonObject ParseJsonObject(StringView buffer, usize* index)
+static JsonObject ParseJsonObject(StringView buffer, usize* index, JsonStructuralIndex* structurals, Allocator* allocator, bool inSitu, Array<ArenaAllocator*>* chunkArenas)
 {
 	CHECK(index);
 
-	SkipWhitespace(buffer, index);
+	structurals->SkipToToken(index);
 	ExpectCharacter(buffer, index, '{');
-	SkipWhitespace(buffer, index);
+	structurals->SkipToToken(index);
 
 	if (PeekCharacter(buffer, *index) == '}')
 	{
 		Advance(index, 1);
-		return JsonObject {};
+		return JsonObject { allocator };
 	}
 
 	static constexpr usize jsonObjectBucketCount = 8;
-	HashTable<String, JsonValue> object(jsonObjectBucketCount, JsonAllocator);
+	HashTable<StringView, JsonValue> object(jsonObjectBucketCount, allocator);
+	Array<String> keyStorage(allocator);
 
 	while (IsInRange(buffer, *index))
 	{
-		String key = ParseString(buffer, index);
-		SkipWhitespace(buffer, index);
+		StringView key;
+		if (inSitu)
+		{
+			key = ParseStringInSitu(buffer, index, structurals, allocator);
+		}
+		else
+		{
+			// Moving a String keeps its characters where they are, so the view stays valid as the storage grows.
+			const String& ownedKey = keyStorage.Emplace(ParseString(buffer, index, structurals, allocator));
+			key = StringView { ownedKey.GetData(), ownedKey.GetLength() };
+		}
+		structurals->SkipToToken(index);
 		ExpectCharacter(buffer, index, ':');
-		JsonValue value = ParseJsonValue(buffer, index);
+		JsonValue value = ParseJsonValue(buffer, index, structurals, allocator, inSitu, chunkArenas);
 
 		object.Add(Move(key), Move(value));
 
@@ -483,22 +948,716 @@ static JsonObject ParseJsonObject(StringView buffer, usize* index)
 			break;
 		}
 		ExpectCharacter(buffer, index, ',');
-		SkipWhitespace(buffer, index);
+		structurals->SkipToToken(index);
 	}
 	ExpectCharacter(buffer, index, '}');
 
-	return JsonObject { Move(object) };
+	return JsonObject { Move(object), Move(keyStorage) };
+}
+
+// The binary form JsonTapeFile caches next to each file: a header, a tape of 64-bit words and the decoded string bytes. A word is
+// a tag in the top byte and a payload below it. Containers are a start and an end word, the start pointing one past its end
+// so a container can be skipped without walking it. Strings point at a 32-bit length and their bytes, and decimals are
+// followed by a word with the bits of the double. Everything is an offset, so the file can be walked straight from memory.
+enum class JsonTapeTag : uint8
+{
+	ObjectStart = '{',
+	ObjectEnd = '}',
+	ArrayStart = '[',
+	ArrayEnd = ']',
+	String = '"',
+	Decimal = 'd',
+	True = 't',
+	False = 'f',
+	Null = 'n',
+};
+
+struct JsonTapeHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint64 SourceHash;
+	uint64 SourceSize;
+	uint64 WordCount;
+	uint64 StringSize;
+};
+
+static constexpr uint32 JsonTapeMagic = 'J' | ('T' << 8) | ('A' << 16) | ('P' << 24);
+static constexpr uint32 JsonTapeVersion = 1;
+static constexpr uint32 JsonTapeTagShift = 56;
+static constexpr uint64 JsonTapePayloadMask = (1ULL << JsonTapeTagShift) - 1;
+
+// Not cryptographic, only meant to notice that a file changed since its tape was written.
+static uint64 HashJsonSource(StringView source)
+{
+	static constexpr uint64 multiplier = 0x9E3779B97F4A7C15ULL;
+
+	uint64 hash = source.GetLength() * multiplier;
+	usize i = 0;
+	for (; i + sizeof(uint64) <= source.GetLength(); i += sizeof(uint64))
+	{
+		uint64 word;
+		memcpy(&word, source.GetData() + i, sizeof(word));
+		hash = (hash ^ word) * multiplier;
+		hash ^= hash >> 29;
+	}
+	for (; i < source.GetLength(); ++i)
+	{
+		hash = (hash ^ static_cast<uint8>(source[i])) * multiplier;
+	}
+	return hash ^ (hash >> 32);
+}
+
+static uint64 MakeTapeWord(JsonTapeTag tag, uint64 payload)
+{
+	CHECK(payload <= JsonTapePayloadMask);
+	return (static_cast<uint64>(tag) << JsonTapeTagShift) | payload;
+}
+
+static JsonTapeTag GetTapeTag(uint64 word)
+{
+	return static_cast<JsonTapeTag>(word >> JsonTapeTagShift);
+}
+
+static uint64 GetTapePayload(uint64 word)
+{
+	return word & JsonTapePayloadMask;
+}
+
+static StringView ReadTapeString(const JsonTapeView& tape, usize* word)
+{
+	VERIFY(*word < tape.WordCount && GetTapeTag(tape.Words[*word]) == JsonTapeTag::String, "Unexpected JSON value type!");
+
+	const usize lengthOffset = GetTapePayload(tape.Words[*word]);
+	uint32 length;
+	VERIFY(lengthOffset + sizeof(length) <= tape.StringSize, "Corrupt JSON tape!");
+	memcpy(&length, tape.Strings + lengthOffset, sizeof(length));
+	VERIFY(lengthOffset + sizeof(length) + length <= tape.StringSize, "Corrupt JSON tape!");
+	*word += 1;
+
+	return StringView { tape.Strings + lengthOffset + sizeof(length), length };
+}
+
+static JsonTapeTag ExpectTapeTag(const JsonTapeView& tape, usize word)
+{
+	VERIFY(word < tape.WordCount, "Corrupt JSON tape!");
+	return GetTapeTag(tape.Words[word]);
+}
+
+// Returns the word after the value starting at the word, without reading it.
+static usize SkipTapeValue(const JsonTapeView& tape, usize word)
+{
+	switch (ExpectTapeTag(tape, word))
+	{
+	case JsonTapeTag::ObjectStart:
+	case JsonTapeTag::ArrayStart:
+	{
+		const usize end = GetTapePayload(tape.Words[word]);
+		VERIFY(end > word && end <= tape.WordCount, "Corrupt JSON tape!");
+		return end;
+	}
+	case JsonTapeTag::Decimal:
+		return word + 2;
+	case JsonTapeTag::String:
+	case JsonTapeTag::True:
+	case JsonTapeTag::False:
+	case JsonTapeTag::Null:
+		return word + 1;
+	case JsonTapeTag::ObjectEnd:
+	case JsonTapeTag::ArrayEnd:
+		break;
+	}
+	VERIFY(false, "Corrupt JSON tape!");
+	return word;
+}
+
+JsonCursor::JsonCursor(StringView buffer)
+	: Buffer(buffer)
+	, Index(0)
+	, Structurals(buffer)
+	, Tape()
+	, Word(0)
+	, End(static_cast<usize>(-1))
+	, AtFirstElement(false)
+{
+}
+
+JsonCursor::JsonCursor(const JsonTapeView& tape)
+	: Buffer()
+	, Index(0)
+	, Structurals(StringView {})
+	, Tape(tape)
+	, Word(0)
+	, End(static_cast<usize>(-1))
+	, AtFirstElement(false)
+{
+	CHECK(tape.Words);
+}
+
+JsonCursor::JsonCursor(StringView buffer, usize start, usize end)
+	: Buffer(buffer)
+	, Index(start)
+	, Structurals(buffer, start)
+	, Tape()
+	, Word(0)
+	, End(end)
+	, AtFirstElement(true)
+{
+}
+
+JsonCursor::JsonCursor(const JsonTapeView& tape, usize word, usize end)
+	: Buffer()
+	, Index(0)
+	, Structurals(StringView {})
+	, Tape(tape)
+	, Word(word)
+	, End(end)
+	, AtFirstElement(true)
+{
+}
+
+JsonTag JsonCursor::PeekTag()
+{
+	if (IsTape())
+	{
+		switch (ExpectTapeTag(Tape, Word))
+		{
+		case JsonTapeTag::ObjectStart:
+			return JsonTag::Object;
+		case JsonTapeTag::ArrayStart:
+			return JsonTag::Array;
+		case JsonTapeTag::String:
+			return JsonTag::String;
+		case JsonTapeTag::Decimal:
+			return JsonTag::Decimal;
+		case JsonTapeTag::True:
+		case JsonTapeTag::False:
+			return JsonTag::Boolean;
+		case JsonTapeTag::Null:
+			return JsonTag::Null;
+		case JsonTapeTag::ObjectEnd:
+		case JsonTapeTag::ArrayEnd:
+			break;
+		}
+		VERIFY(false, "Failed to parse JSON value!");
+		return JsonTag::None;
+	}
+
+	Structurals.SkipToToken(&Index);
+
+	const char leading = PeekCharacter(Buffer, Index);
+	if (leading == '"')
+	{
+		return JsonTag::String;
+	}
+	if (IsDigit(leading) || leading == '-' || leading == '+')
+	{
+		return JsonTag::Decimal;
+	}
+	if (leading == '{')
+	{
+		return JsonTag::Object;
+	}
+	if (leading == '[')
+	{
+		return JsonTag::Array;
+	}
+	if (leading == 't' || leading == 'f')
+	{
+		return JsonTag::Boolean;
+	}
+	if (leading == 'n')
+	{
+		return JsonTag::Null;
+	}
+	VERIFY(false, "Failed to parse JSON value!");
+	return JsonTag::None;
+}
+
+void JsonCursor::BeginObject()
+{
+	if (IsTape())
+	{
+		VERIFY(ExpectTapeTag(Tape, Word) == JsonTapeTag::ObjectStart, "Failed to parse expected character!");
+		++Word;
+		return;
+	}
+
+	Structurals.SkipToToken(&Index);
+	ExpectCharacter(Buffer, &Index, '{');
+	AtFirstElement = true;
+}
+
+bool JsonCursor::NextMember(StringView* key)
+{
+	CHECK(key);
+
+	if (IsTape())
+	{
+		if (ExpectTapeTag(Tape, Word) == JsonTapeTag::ObjectEnd)
+		{
+			++Word;
+			return false;
+		}
+		*key = ReadTapeString(Tape, &Word);
+		return true;
+	}
+
+	Structurals.SkipToToken(&Index);
+	if (PeekCharacter(Buffer, Index) == '}')
+	{
+		Advance(&Index, 1);
+		AtFirstElement = false;
+		return false;
+	}
+
+	if (!AtFirstElement)
+	{
+		ExpectCharacter(Buffer, &Index, ',');
+		Structurals.SkipToToken(&Index);
+	}
+	AtFirstElement = false;
+
+	*key = ParseStringView(Buffer, &Index, &Structurals);
+	Structurals.SkipToToken(&Index);
+	ExpectCharacter(Buffer, &Index, ':');
+	return true;
+}
+
+void JsonCursor::BeginArray()
+{
+	if (IsTape())
+	{
+		VERIFY(ExpectTapeTag(Tape, Word) == JsonTapeTag::ArrayStart, "Failed to parse expected character!");
+		++Word;
+		return;
+	}
+
+	Structurals.SkipToToken(&Index);
+	ExpectCharacter(Buffer, &Index, '[');
+	AtFirstElement = true;
+}
+
+bool JsonCursor::NextElement()
+{
+	if (IsTape())
+	{
+		if (Word == End)
+		{
+			return false;
+		}
+		if (ExpectTapeTag(Tape, Word) == JsonTapeTag::ArrayEnd)
+		{
+			++Word;
+			return false;
+		}
+		return true;
+	}
+
+	Structurals.SkipToToken(&Index);
+	if (Index == End)
+	{
+		return false;
+	}
+	if (PeekCharacter(Buffer, Index) == ']')
+	{
+		Advance(&Index, 1);
+		AtFirstElement = false;
+		return false;
+	}
+
+	if (!AtFirstElement)
+	{
+		ExpectCharacter(Buffer, &Index, ',');
+	}
+	AtFirstElement = false;
+	return true;
+}
+
+StringView JsonCursor::ReadString()
+{
+	if (IsTape())
+	{
+		return ReadTapeString(Tape, &Word);
+	}
+
+	Structurals.SkipToToken(&Index);
+	return ParseStringView(Buffer, &Index, &Structurals);
+}
+
+double JsonCursor::ReadDecimal()
+{
+	if (IsTape())
+	{
+		VERIFY(ExpectTapeTag(Tape, Word) == JsonTapeTag::Decimal && Word + 1 < Tape.WordCount, "Failed to parse decimal!");
+		double decimal;
+		memcpy(&decimal, &Tape.Words[Word + 1], sizeof(decimal));
+		Word += 2;
+		return decimal;
+	}
+
+	Structurals.SkipToToken(&Index);
+	return ParseDecimal(Buffer, &Index);
+}
+
+bool JsonCursor::ReadBoolean()
+{
+	if (IsTape())
+	{
+		const JsonTapeTag tag = ExpectTapeTag(Tape, Word);
+		VERIFY(tag == JsonTapeTag::True || tag == JsonTapeTag::False, "Failed to parse expected character!");
+		++Word;
+		return tag == JsonTapeTag::True;
+	}
+
+	Structurals.SkipToToken(&Index);
+	if (PeekCharacter(Buffer, Index) == 't')
+	{
+		ExpectString(Buffer, &Index, "true"_view);
+		return true;
+	}
+	ExpectString(Buffer, &Index, "false"_view);
+	return false;
+}
+
+void JsonCursor::ReadNull()
+{
+	if (IsTape())
+	{
+		VERIFY(ExpectTapeTag(Tape, Word) == JsonTapeTag::Null, "Failed to parse expected character!");
+		++Word;
+		return;
+	}
+
+	Structurals.SkipToToken(&Index);
+	ExpectString(Buffer, &Index, "null"_view);
+}
+
+void JsonCursor::SkipValue()
+{
+	if (IsTape())
+	{
+		Word = SkipTapeValue(Tape, Word);
+		return;
+	}
+
+	switch (PeekTag())
+	{
+	case JsonTag::Object:
+	{
+		BeginObject();
+		StringView key;
+		while (NextMember(&key))
+		{
+			SkipValue();
+		}
+		break;
+	}
+	case JsonTag::Array:
+		BeginArray();
+		while (NextElement())
+		{
+			SkipValue();
+		}
+		break;
+	case JsonTag::String:
+		ReadString();
+		break;
+	case JsonTag::Decimal:
+		ReadDecimal();
+		break;
+	case JsonTag::Boolean:
+		ReadBoolean();
+		break;
+	case JsonTag::Null:
+		ReadNull();
+		break;
+	case JsonTag::None:
+		break;
+	}
+}
+
+void JsonCursor::SplitArray(usize minimumChunkLength, usize maxChunkCount, Array<JsonCursor>* chunks)
+{
+	CHECK(chunks);
+	CHECK(minimumChunkLength != 0 && maxChunkCount != 0);
+
+	if (IsTape())
+	{
+		VERIFY(ExpectTapeTag(Tape, Word) == JsonTapeTag::ArrayStart, "Failed to parse expected character!");
+		const usize arrayEnd = SkipTapeValue(Tape, Word) - 1;
+
+		// Containers point past their end, so finding the elements only touches the first word of each.
+		Array<usize> elementWords(JsonAllocator);
+		usize word = Word + 1;
+		while (word < arrayEnd)
+		{
+			elementWords.Add(word);
+			word = SkipTapeValue(Tape, word);
+		}
+		VERIFY(word == arrayEnd && GetTapeTag(Tape.Words[arrayEnd]) == JsonTapeTag::ArrayEnd, "Corrupt JSON tape!");
+
+		const usize elementCount = elementWords.GetLength();
+		const usize chunkCount = Max<usize>(Min(elementCount / minimumChunkLength, maxChunkCount), Min<usize>(elementCount, 1));
+		for (usize chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			const usize first = elementCount * chunk / chunkCount;
+			const usize last = elementCount * (chunk + 1) / chunkCount;
+			chunks->Add(JsonCursor { Tape, elementWords[first], (last < elementCount) ? elementWords[last] : arrayEnd });
+		}
+
+		Word = arrayEnd + 1;
+		AtFirstElement = false;
+		return;
+	}
+
+	Structurals.SkipToToken(&Index);
+
+	Array<uint32> bounds(JsonAllocator);
+	const usize elementCount = Structurals.FindArrayElements(Index, &bounds);
+	const usize closingBracket = bounds[bounds.GetLength() - 1];
+
+	const usize chunkCount = Max<usize>(Min(elementCount / minimumChunkLength, maxChunkCount), Min<usize>(elementCount, 1));
+	for (usize chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const usize first = elementCount * chunk / chunkCount;
+		const usize last = elementCount * (chunk + 1) / chunkCount;
+
+		// A run starts just past the bracket or comma before its first element and ends on the comma before the next run's
+		// first element, or on the closing bracket.
+		chunks->Add(JsonCursor { Buffer, bounds[first] + 1, bounds[last] });
+	}
+
+	Index = closingBracket;
+	ExpectCharacter(Buffer, &Index, ']');
+	AtFirstElement = false;
+}
+
+static void WriteTapeString(StringView buffer, usize* index, JsonStructuralIndex* structurals, JsonTape* tape)
+{
+	const StringView raw = ParseStringView(buffer, index, structurals);
+
+	const usize lengthOffset = tape->Strings.GetLength();
+	tape->Words.Add(MakeTapeWord(JsonTapeTag::String, lengthOffset));
+
+	uint32 length = 0;
+	for (usize i = 0; i < sizeof(length); ++i)
+	{
+		tape->Strings.Add('\0');
+	}
+	DecodeEscapes(raw, [tape, &length](char c)
+	{
+		tape->Strings.Add(c);
+		++length;
+	});
+	memcpy(tape->Strings.GetData() + lengthOffset, &length, sizeof(length));
+}
+
+static void WriteTapeContainer(StringView buffer, usize* index, JsonStructuralIndex* structurals, JsonTape* tape, bool isObject);
+
+static void WriteTapeValue(StringView buffer, usize* index, JsonStructuralIndex* structurals, JsonTape* tape)
+{
+	structurals->SkipToToken(index);
+
+	const char leading = PeekCharacter(buffer, *index);
+	if (leading == '"')
+	{
+		WriteTapeString(buffer, index, structurals, tape);
+	}
+	else if (IsDigit(leading) || leading == '-' || leading == '+')
+	{
+		const double decimal = ParseDecimal(buffer, index);
+		uint64 bits;
+		memcpy(&bits, &decimal, sizeof(bits));
+		tape->Words.Add(MakeTapeWord(JsonTapeTag::Decimal, 0));
+		tape->Words.Add(bits);
+	}
+	else if (leading == '{' || leading == '[')
+	{
+		WriteTapeContainer(buffer, index, structurals, tape, leading == '{');
+	}
+	else if (leading == 't')
+	{
+		ExpectString(buffer, index, "true"_view);
+		tape->Words.Add(MakeTapeWord(JsonTapeTag::True, 0));
+	}
+	else if (leading == 'f')
+	{
+		ExpectString(buffer, index, "false"_view);
+		tape->Words.Add(MakeTapeWord(JsonTapeTag::False, 0));
+	}
+	else if (leading == 'n')
+	{
+		ExpectString(buffer, index, "null"_view);
+		tape->Words.Add(MakeTapeWord(JsonTapeTag::Null, 0));
+	}
+	else
+	{
+		VERIFY(false, "Failed to parse JSON value!");
+	}
+	structurals->SkipToToken(index);
+}
+
+static void WriteTapeContainer(StringView buffer, usize* index, JsonStructuralIndex* structurals, JsonTape* tape, bool isObject)
+{
+	const char open = isObject ? '{' : '[';
+	const char close = isObject ? '}' : ']';
+
+	structurals->SkipToToken(index);
+	ExpectCharacter(buffer, index, open);
+	structurals->SkipToToken(index);
+
+	const usize start = tape->Words.GetLength();
+	tape->Words.Add(0);
+
+	if (PeekCharacter(buffer, *index) != close)
+	{
+		while (IsInRange(buffer, *index))
+		{
+			if (isObject)
+			{
+				WriteTapeString(buffer, index, structurals, tape);
+				structurals->SkipToToken(index);
+				ExpectCharacter(buffer, index, ':');
+			}
+			WriteTapeValue(buffer, index, structurals, tape);
+
+			if (PeekCharacter(buffer, *index) != ',')
+			{
+				break;
+			}
+			ExpectCharacter(buffer, index, ',');
+			structurals->SkipToToken(index);
+		}
+	}
+	ExpectCharacter(buffer, index, close);
+
+	tape->Words.Add(MakeTapeWord(isObject ? JsonTapeTag::ObjectEnd : JsonTapeTag::ArrayEnd, start));
+	tape->Words[start] = MakeTapeWord(isObject ? JsonTapeTag::ObjectStart : JsonTapeTag::ArrayStart, tape->Words.GetLength());
+}
+
+// Returns false when the cached file is missing, stale or from another version, leaving the view untouched.
+static bool GetTapeView(const uint8* tapeFile, usize tapeFileSize, uint64 sourceHash, usize sourceSize, JsonTapeView* tape)
+{
+	JsonTapeHeader header;
+	if (!tapeFile || tapeFileSize < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, tapeFile, sizeof(header));
+
+	const bool isCurrent = header.Magic == JsonTapeMagic && header.Version == JsonTapeVersion;
+	const bool isFresh = header.SourceHash == sourceHash && header.SourceSize == sourceSize;
+	if (!isCurrent || !isFresh || header.WordCount == 0 || tapeFileSize != sizeof(header) + header.WordCount * sizeof(uint64) + header.StringSize)
+	{
+		return false;
+	}
+
+	// The header is a whole number of words, so the tape stays aligned however the file was loaded.
+	static_assert(sizeof(JsonTapeHeader) % sizeof(uint64) == 0, "Tape words must follow the header aligned!");
+	tape->Words = reinterpret_cast<const uint64*>(tapeFile + sizeof(header));
+	tape->WordCount = header.WordCount;
+	tape->Strings = reinterpret_cast<const char*>(tape->Words + tape->WordCount);
+	tape->StringSize = header.StringSize;
+	return true;
+}
+
+static bool WriteTapeFile(StringView tapePath, const JsonTape& tape, uint64 sourceHash, usize sourceSize)
+{
+	const JsonTapeHeader header =
+	{
+		.Magic = JsonTapeMagic,
+		.Version = JsonTapeVersion,
+		.SourceHash = sourceHash,
+		.SourceSize = sourceSize,
+		.WordCount = tape.Words.GetLength(),
+		.StringSize = tape.Strings.GetLength(),
+	};
+
+	const usize wordsSize = tape.Words.GetLength() * sizeof(uint64);
+	const usize fileSize = sizeof(header) + wordsSize + tape.Strings.GetLength();
+	uint8* file = static_cast<uint8*>(JsonAllocator->Allocate(fileSize));
+	memcpy(file, &header, sizeof(header));
+	memcpy(file + sizeof(header), tape.Words.GetData(), wordsSize);
+	memcpy(file + sizeof(header) + wordsSize, tape.Strings.GetData(), tape.Strings.GetLength());
+
+	// Another process may have the old tape mapped, so it is replaced rather than written over.
+	const bool written = ReplaceEntireFile(tapePath, file, fileSize);
+	JsonAllocator->Deallocate(file, fileSize);
+	return written;
 }
 
 JsonObject LoadJson(StringView filePath)
 {
-	usize jsonFileSize;
-	char* jsonFileData = reinterpret_cast<char*>(Platform::ReadEntireFile(filePath.GetData(), filePath.GetLength(), &jsonFileSize, *JsonAllocator));
-	const StringView jsonFileView = { jsonFileData, jsonFileSize };
+	const MappedFile jsonFile(filePath);
+	const StringView jsonFileView = jsonFile.GetView();
+
+	JsonStructuralIndex structurals(jsonFileView);
+	usize index = 0;
+	return ParseJsonObject(jsonFileView, &index, &structurals, JsonAllocator, false, nullptr);
+}
+
+JsonTapeFile::JsonTapeFile(StringView filePath)
+	: TapeFile()
+	, BuiltTape()
+	, View()
+{
+	const MappedFile jsonFile(filePath);
+	const StringView jsonFileView = jsonFile.GetView();
+	const uint64 sourceHash = HashJsonSource(jsonFileView);
+
+	// The tape lives next to the file it caches, which keys it by path. The header keys it by contents.
+	const StringView tapeExtension = ".tape"_view;
+	char tapePath[512];
+	VERIFY(filePath.GetLength() + tapeExtension.GetLength() < sizeof(tapePath), "JSON file path is too long!");
+	Platform::MemoryCopy(tapePath, filePath.GetData(), filePath.GetLength());
+	Platform::MemoryCopy(tapePath + filePath.GetLength(), tapeExtension.GetData(), tapeExtension.GetLength());
+	const StringView tapePathView = { tapePath, filePath.GetLength() + tapeExtension.GetLength() };
+
+	if (TapeFile.Open(tapePathView) && GetTapeView(TapeFile.GetData(), TapeFile.GetSize(), sourceHash, jsonFileView.GetLength(), &View))
+	{
+		return;
+	}
+	TapeFile.Close();
+
+	// A stale or missing tape is rebuilt from the text. Writing it back is best effort, the assets may be read-only.
+	JsonStructuralIndex structurals(jsonFileView);
+	usize index = 0;
+	WriteTapeContainer(jsonFileView, &index, &structurals, &BuiltTape, true);
+	WriteTapeFile(tapePathView, BuiltTape, sourceHash, jsonFileView.GetLength());
+
+	View = JsonTapeView { BuiltTape.Words.GetData(), BuiltTape.Words.GetLength(), BuiltTape.Strings.GetData(), BuiltTape.Strings.GetLength() };
+}
+
+JsonDocument::JsonDocument(StringView filePath)
+	: File(filePath)
+	, Arena()
+	, Root(nullptr)
+	, ChunkArenas(JsonAllocator)
+{
+	const StringView jsonFileView = File.GetView();
 
+	// The index is only needed while parsing, so it stays out of the arena.
+	JsonStructuralIndex structurals(jsonFileView);
 	usize index = 0;
-	const JsonObject object = ParseJsonObject(jsonFileView, &index);
+	Root = Arena.Create<JsonObject>(ParseJsonObject(jsonFileView, &index, &structurals, &Arena, true, &ChunkArenas));
+}
 
-	JsonAllocator->Deallocate(jsonFileData, jsonFileSize);
-	return object;
+JsonDocument::~JsonDocument()
+{
+	for (ArenaAllocator* arena : ChunkArenas)
+	{
+		arena->~ArenaAllocator();
+		JsonAllocator->Deallocate(arena, sizeof(*arena));
+	}
+}
+
+usize JsonDocument::GetMemoryUsed() const
+{
+	usize used = Arena.GetUsedSize();
+	for (const ArenaAllocator* arena : ChunkArenas)
+	{
+		used += arena->GetUsedSize();
+	}
+	return used;
 }
@@ -1,7 +1,11 @@
 ﻿#pragma once
 
+#include "ArenaAllocator.hpp"
+#include "File.hpp"
+
 #include "Luft/Array.hpp"
 #include "Luft/HashTable.hpp"
+#include "Luft/NoCopy.hpp"
 #include "Luft/String.hpp"
 
 class JsonObject;
@@ -31,6 +35,7 @@ public:
 	explicit JsonValue(JsonTag null)
 		: NullValue(nullptr)
 		, Tag(JsonTag::Null)
+		, IsStringView(false)
 	{
 		CHECK(null == JsonTag::Null);
 	}
@@ -38,30 +43,43 @@ public:
 	explicit JsonValue(JsonObject* owning)
 		: ObjectValue(owning)
 		, Tag(JsonTag::Object)
+		, IsStringView(false)
 	{
 	}
 
 	explicit JsonValue(JsonArray&& array)
 		: ArrayValue(Move(array))
 		, Tag(JsonTag::Array)
+		, IsStringView(false)
 	{
 	}
 
 	explicit JsonValue(String&& string)
 		: StringValue(Move(string))
 		, Tag(JsonTag::String)
+		, IsStringView(false)
+	{
+	}
+
+	// The characters belong to someone else, a JsonDocument's buffer or arena.
+	explicit JsonValue(StringView string)
+		: StringViewValue(string)
+		, Tag(JsonTag::String)
+		, IsStringView(true)
 	{
 	}
 
 	explicit JsonValue(double decimal)
 		: DecimalValue(decimal)
 		, Tag(JsonTag::Decimal)
+		, IsStringView(false)
 	{
 	}
 
 	explicit JsonValue(bool boolean)
 		: BooleanValue(boolean)
 		, Tag(JsonTag::Boolean)
+		, IsStringView(false)
 	{
 	}
 
@@ -91,10 +109,10 @@ public:
 		return ArrayValue;
 	}
 
-	const String& GetString() const
+	StringView GetString() const
 	{
 		VERIFY(Tag == JsonTag::String, "Unexpected JSON value type!");
-		return StringValue;
+		return IsStringView ? StringViewValue : StringView { StringValue.GetData(), StringValue.GetLength() };
 	}
 
 	double GetDecimal() const
@@ -115,11 +133,13 @@ private:
 		JsonObject* ObjectValue;
 		JsonArray ArrayValue;
 		String StringValue;
+		StringView StringViewValue;
 		double DecimalValue;
 		bool BooleanValue;
 		void* NullValue;
 	};
 	JsonTag Tag;
+	bool IsStringView;
 };
 
 class JsonObject
@@ -127,11 +147,19 @@ class JsonObject
 public:
 	JsonObject()
 		: Objects(1)
+		, KeyStorage()
+	{
+	}
+
+	explicit JsonObject(Allocator* allocator)
+		: Objects(1, allocator)
+		, KeyStorage(allocator)
 	{
 	}
 
-	explicit JsonObject(HashTable<String, JsonValue>&& objects)
+	JsonObject(HashTable<StringView, JsonValue>&& objects, Array<String>&& keyStorage)
 		: Objects(Move(objects))
+		, KeyStorage(Move(keyStorage))
 	{
 	}
 
@@ -153,7 +181,178 @@ public:
 	}
 
 private:
-	HashTable<String, JsonValue> Objects;
+	HashTable<StringView, JsonValue> Objects;
+
+	// Owns the key characters when they are copied out of the file, in situ the keys point into the document instead.
+	Array<String> KeyStorage;
+};
+
+// Stage one of parsing: the offset of every token in a buffer, found 64 bytes at a time with AVX2. Tokens are the
+// structural characters outside strings, both quotes of every string and the first character of every number or literal,
+// so the parser steps from one token to the next instead of skipping whitespace and scanning strings byte by byte. The
+// buffer is scanned a window at a time as the reader moves forward, so the index stays the same size however large the
+// buffer is, and the reader never moves back.
+class JsonStructuralIndex
+{
+public:
+	// Starts scanning at start, which must be outside of any string, number or literal.
+	explicit JsonStructuralIndex(StringView buffer, usize start = 0);
+
+	// Moves the index forward to the next token, or to the end of the buffer when there are none left.
+	void SkipToToken(usize* index);
+	// Returns the offset of the quote that closes the string opening at the index.
+	usize FindClosingQuote(usize openingQuote);
+
+	// Walks the array opening at the bracket to its closing bracket by the structural characters alone, without parsing the
+	// elements. Collects the offsets of both brackets and of the commas between them, so element i lies between bounds i and
+	// i + 1, and returns the element count. Leaves the reader on the closing bracket.
+	usize FindArrayElements(usize openingBracket, Array<uint32>* bounds);
+
+	// A position to come back to after walking ahead, such as with FindArrayElements.
+	struct Mark
+	{
+		usize WindowStart;
+		uint64 PreviousEscaped;
+		uint64 PreviousInString;
+		uint64 PreviousScalar;
+		usize Next;
+	};
+
+	Mark GetMark() const;
+	// Free while the reader is still in the window it was marked in, otherwise that window is scanned again.
+	void Rewind(const Mark& mark);
+
+private:
+	// The offset of the token the reader is on, or the end of the buffer past the last token.
+	usize GetToken();
+	// Moves the reader to the first token at or past the offset and returns it.
+	usize SeekToken(usize offset);
+	void ScanWindow();
+
+	StringView Buffer;
+	usize ScanOffset;
+
+	// Carried from the end of one window to the start of the next.
+	uint64 PreviousEscaped;
+	uint64 PreviousInString;
+	uint64 PreviousScalar;
+
+	// The tokens of the last window scanned. Grown a block at a time, only the first TokenCount offsets are tokens.
+	Array<uint32> Offsets;
+	usize TokenCount;
+	usize Next;
+
+	// Where the last window was scanned from and the carries it started with.
+	Mark Window;
+};
+
+// The binary form of a JSON file cached next to it, see JsonTapeFile: tagged 64-bit words and the decoded string bytes they
+// point into.
+struct JsonTape
+{
+	Array<uint64> Words;
+	Array<char> Strings;
+};
+
+// A tape as it sits in memory, either just built or mapped from its file.
+struct JsonTapeView
+{
+	const uint64* Words;
+	usize WordCount;
+	const char* Strings;
+	usize StringSize;
+};
+
+// Pulls values out of a JSON buffer one at a time, for documents too large to hold as a tree of JsonObject allocations.
+// The buffer must outlive the cursor and the string views it returns. A cursor over a tape walks its words in place rather
+// than the text.
+class JsonCursor
+{
+public:
+	explicit JsonCursor(StringView buffer);
+	explicit JsonCursor(const JsonTapeView& tape);
+
+	JsonTag PeekTag();
+
+	void BeginObject();
+	// Reads the next key and its colon, or consumes the closing brace and returns false.
+	bool NextMember(StringView* key);
+
+	void BeginArray();
+	// Moves to the next element, or consumes the closing bracket and returns false.
+	bool NextElement();
+
+	// Escape sequences are left as written in a text buffer, and are already decoded in a tape.
+	StringView ReadString();
+	double ReadDecimal();
+	bool ReadBoolean();
+	void ReadNull();
+
+	void SkipValue();
+
+	// Splits the array at the cursor into runs of whole elements, at least minimumChunkLength long and at most maxChunkCount
+	// of them, and moves past the array. Each run is a cursor of its own, already inside the array like after BeginArray,
+	// so the runs can be read on separate threads.
+	void SplitArray(usize minimumChunkLength, usize maxChunkCount, Array<JsonCursor>* chunks);
+
+private:
+	JsonCursor(StringView buffer, usize start, usize end);
+	JsonCursor(const JsonTapeView& tape, usize word, usize end);
+
+	bool IsTape() const { return Tape.Words != nullptr; }
+
+	StringView Buffer;
+	usize Index;
+	JsonStructuralIndex Structurals;
+
+	// Null words for a cursor over text.
+	JsonTapeView Tape;
+	usize Word;
+
+	// Where a run from SplitArray stops, as an offset into the text or a word of the tape. Past the end for a cursor over a
+	// whole document.
+	usize End;
+
+	bool AtFirstElement;
 };
 
 JsonObject LoadJson(StringView filePath);
+
+// A JSON file read through the tape cached next to it as <file>.tape. While the file's contents still hash to what the tape
+// was written from, the text is never tokenized: cursors walk the mapped tape, strings are views into it and containers are
+// skipped in one step. A missing or stale tape is built from the text and written back. Cursors must not outlive the file.
+class JsonTapeFile : public NoCopy
+{
+public:
+	explicit JsonTapeFile(StringView filePath);
+
+	JsonCursor GetCursor() const { return JsonCursor { View }; }
+
+private:
+	MappedFile TapeFile;
+	// Only filled when the tape had to be built from the text.
+	JsonTape BuiltTape;
+	JsonTapeView View;
+};
+
+// Parses a whole file into arenas owned by the document: the tree is a few large allocations and is freed in one go.
+// The file stays mapped for as long as the document lives, so strings and keys without escapes are views into it rather than copies.
+// Values are never destroyed individually, so references into the document must not outlive it.
+class JsonDocument : public NoCopy
+{
+public:
+	explicit JsonDocument(StringView filePath);
+	~JsonDocument();
+
+	const JsonObject& GetRoot() const { return *Root; }
+
+	usize GetMemoryUsed() const;
+
+private:
+	MappedFile File;
+	ArenaAllocator Arena;
+	JsonObject* Root;
+
+	// Large arrays are parsed in runs on the thread pool, each run allocating from an arena of its own.
+	Array<ArenaAllocator*> ChunkArenas;
+};
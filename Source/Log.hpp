@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Luft/Platform.hpp"
+
+// Formats with Platform::StringPrint into a line-sized buffer, so longer messages are truncated.
+template<typename... Arguments>
+void Log(const char* format, Arguments... arguments)
+{
+	char text[256] = {};
+	Platform::StringPrint(format, text, sizeof(text), arguments...);
+	Platform::Log(text);
+}
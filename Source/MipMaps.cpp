@@ -0,0 +1,218 @@
+#include "MipMaps.hpp"
+#include "ThreadPool.hpp"
+
+#include "Luft/Array.hpp"
+
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+static constexpr float KaiserRadius = 3.0f;
+static constexpr float KaiserAlpha = 4.0f;
+
+// The source pixels each destination pixel is made of along one axis, TapCount of them for every destination pixel. Source
+// indices are clamped to the image and the weights of each destination pixel add up to one.
+struct FilterKernel
+{
+	uint32 TapCount;
+	Array<uint32> Indices;
+	Array<float> Weights;
+};
+
+static float Sinc(float x)
+{
+	if (fabsf(x) < 1e-6f)
+	{
+		return 1.0f;
+	}
+	const float angle = Pi * x;
+	return sinf(angle) / angle;
+}
+
+// The zeroth order modified Bessel function of the first kind, summed from its power series.
+static float BesselI0(float x)
+{
+	const float quarterSquare = x * x * 0.25f;
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (uint32 k = 1; k < 32 && term > sum * 1e-8f; ++k)
+	{
+		term *= quarterSquare / static_cast<float>(k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+// Distance is measured in destination pixels.
+static float Kaiser(float distance)
+{
+	const float t = distance / KaiserRadius;
+	if (fabsf(t) >= 1.0f)
+	{
+		return 0.0f;
+	}
+	return Sinc(distance) * BesselI0(KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(KaiserAlpha);
+}
+
+static FilterKernel CreateFilterKernel(uint32 sourceLength, uint32 destinationLength, MipMapFilter filter)
+{
+	// Source pixel j covers [j, j + 1), so destination pixel i is centered on (i + 0.5) * scale.
+	const float scale = static_cast<float>(sourceLength) / static_cast<float>(destinationLength);
+	const float radius = (filter == MipMapFilter::Box) ? 0.5f * scale : KaiserRadius * scale;
+	const uint32 maximumTapCount = static_cast<uint32>(ceilf(2.0f * radius)) + 1;
+
+	Array<int32> firsts(&GlobalAllocator::Get());
+	Array<float> weights(&GlobalAllocator::Get());
+	firsts.GrowToLengthUninitialized(destinationLength);
+	weights.GrowToLengthUninitialized(static_cast<usize>(destinationLength) * maximumTapCount);
+
+	uint32 tapCount = 1;
+	for (uint32 i = 0; i < destinationLength; ++i)
+	{
+		const float center = (static_cast<float>(i) + 0.5f) * scale;
+		const int32 first = static_cast<int32>(floorf(center - radius));
+		firsts[i] = first;
+
+		float* tapWeights = &weights[static_cast<usize>(i) * maximumTapCount];
+		float total = 0.0f;
+		for (uint32 tap = 0; tap < maximumTapCount; ++tap)
+		{
+			const float position = static_cast<float>(first + static_cast<int32>(tap));
+
+			float weight;
+			if (filter == MipMapFilter::Box)
+			{
+				weight = Max(Min(position + 1.0f, center + radius) - Max(position, center - radius), 0.0f);
+			}
+			else
+			{
+				weight = Kaiser((position + 0.5f - center) / scale);
+			}
+
+			tapWeights[tap] = weight;
+			total += weight;
+			if (weight != 0.0f)
+			{
+				tapCount = Max(tapCount, tap + 1);
+			}
+		}
+		for (uint32 tap = 0; tap < maximumTapCount; ++tap)
+		{
+			tapWeights[tap] /= total;
+		}
+	}
+
+	// The last taps are outside the filter for every destination pixel whenever the scale is a whole number.
+	FilterKernel kernel =
+	{
+		.TapCount = tapCount,
+		.Indices = Array<uint32>(&GlobalAllocator::Get()),
+		.Weights = Array<float>(&GlobalAllocator::Get()),
+	};
+	kernel.Indices.GrowToLengthUninitialized(static_cast<usize>(destinationLength) * tapCount);
+	kernel.Weights.GrowToLengthUninitialized(static_cast<usize>(destinationLength) * tapCount);
+	for (uint32 i = 0; i < destinationLength; ++i)
+	{
+		for (uint32 tap = 0; tap < tapCount; ++tap)
+		{
+			const int32 index = Min(Max(firsts[i] + static_cast<int32>(tap), 0), static_cast<int32>(sourceLength) - 1);
+			kernel.Indices[static_cast<usize>(i) * tapCount + tap] = static_cast<uint32>(index);
+			kernel.Weights[static_cast<usize>(i) * tapCount + tap] = weights[static_cast<usize>(i) * maximumTapCount + tap];
+		}
+	}
+	return kernel;
+}
+
+static void FilterRow(const Float4* source, const FilterKernel& kernel, uint32 destinationWidth, Float4* destination)
+{
+	const uint32 tapCount = kernel.TapCount;
+	for (uint32 x = 0; x < destinationWidth; ++x)
+	{
+		const uint32* indices = &kernel.Indices[static_cast<usize>(x) * tapCount];
+		const float* weights = &kernel.Weights[static_cast<usize>(x) * tapCount];
+
+#if defined(__AVX2__)
+		// A pixel is exactly one 128-bit vector.
+		__m128 sum = _mm_setzero_ps();
+		for (uint32 tap = 0; tap < tapCount; ++tap)
+		{
+			const __m128 pixel = _mm_loadu_ps(reinterpret_cast<const float*>(source + indices[tap]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), pixel));
+		}
+		_mm_storeu_ps(reinterpret_cast<float*>(destination + x), sum);
+#else
+		Float4 sum = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (uint32 tap = 0; tap < tapCount; ++tap)
+		{
+			const Float4& pixel = source[indices[tap]];
+			sum.X += weights[tap] * pixel.X;
+			sum.Y += weights[tap] * pixel.Y;
+			sum.Z += weights[tap] * pixel.Z;
+			sum.W += weights[tap] * pixel.W;
+		}
+		destination[x] = sum;
+#endif
+	}
+}
+
+// Every tap is a whole row, so the columns are filtered side by side.
+static void FilterColumns(const Float4* source, uint32 width, const uint32* indices, const float* weights, uint32 tapCount, Float4* destination)
+{
+	const usize floatCount = static_cast<usize>(width) * 4;
+	float* output = reinterpret_cast<float*>(destination);
+
+	usize i = 0;
+#if defined(__AVX2__)
+	for (; i + 8 <= floatCount; i += 8)
+	{
+		__m256 sum = _mm256_setzero_ps();
+		for (uint32 tap = 0; tap < tapCount; ++tap)
+		{
+			const float* row = reinterpret_cast<const float*>(source + static_cast<usize>(indices[tap]) * width);
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[tap]), _mm256_loadu_ps(row + i)));
+		}
+		_mm256_storeu_ps(output + i, sum);
+	}
+#endif
+	for (; i < floatCount; ++i)
+	{
+		float sum = 0.0f;
+		for (uint32 tap = 0; tap < tapCount; ++tap)
+		{
+			const float* row = reinterpret_cast<const float*>(source + static_cast<usize>(indices[tap]) * width);
+			sum += weights[tap] * row[i];
+		}
+		output[i] = sum;
+	}
+}
+
+void DownsampleImage(const Float4* source, uint32 width, uint32 height, MipMapFilter filter, Float4* destination, ThreadPool* threadPool)
+{
+	CHECK(source);
+	CHECK(destination);
+	CHECK(threadPool);
+	CHECK(width != 0 && height != 0);
+
+	const uint32 destinationWidth = Max(width / 2, 1u);
+	const uint32 destinationHeight = Max(height / 2, 1u);
+
+	const FilterKernel horizontal = CreateFilterKernel(width, destinationWidth, filter);
+	const FilterKernel vertical = CreateFilterKernel(height, destinationHeight, filter);
+
+	Array<Float4> rows(&GlobalAllocator::Get());
+	rows.GrowToLengthUninitialized(static_cast<usize>(destinationWidth) * height);
+
+	threadPool->ParallelFor(height, [&](usize y, usize)
+	{
+		FilterRow(source + y * width, horizontal, destinationWidth, rows.GetData() + y * destinationWidth);
+	});
+
+	threadPool->ParallelFor(destinationHeight, [&](usize y, usize)
+	{
+		const usize taps = y * vertical.TapCount;
+		FilterColumns(rows.GetData(), destinationWidth, &vertical.Indices[taps], &vertical.Weights[taps], vertical.TapCount,
+					  destination + y * destinationWidth);
+	});
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Luft/Base.hpp"
+#include "Luft/Math.hpp"
+
+class ThreadPool;
+
+enum class MipMapFilter
+{
+	// Averages the source pixels each destination pixel covers. Cheap and never rings, but aliases and blurs.
+	Box,
+	// A Kaiser-windowed sinc three destination pixels wide. Keeps more detail, at the cost of a little ringing at hard edges.
+	Kaiser,
+};
+
+// Halves each side of the image, rounded down to at least one pixel, and writes the result to destination. The pixels are
+// linear RGBA, and the rows then the columns are filtered a row at a time on the thread pool. Edges repeat the outermost
+// pixels, and the filter may overshoot past the range of the source.
+void DownsampleImage(const Float4* source, uint32 width, uint32 height, MipMapFilter filter, Float4* destination, ThreadPool* threadPool);
@@ -1,71 +1,27 @@
 #include "Raytracer.hpp"
+#include "BVH.hpp"
 #include "CameraController.hpp"
-#include "DrawText.hpp"
+#include "Scene.hpp"
 
-#include "Luft/Random.hpp"
-
-Raytracer::Raytracer(const Platform::Window* window)
+Raytracer::Raytracer(const Platform::Window* window, Scene* scene)
 	: Device(window)
 	, Graphics(Device.CreateGraphicsContext())
 	, FrameIndex(0)
+	, MaxDepth(scene->MaxDepth)
+	, SamplesPerPixel(scene->SamplesPerPixel)
+	, NoiseThreshold(scene->NoiseThreshold)
 	, AverageGpuTime(0.0)
 {
-	const auto lerp = [](float a, float b, float t)
-	{
-		return a + (b - a) * t;
-	};
-
 	CreateScreenTextures(window->DrawWidth, window->DrawHeight);
 
 	CreatePipelines();
 
 	DrawText::Get().Init(&Device);
+	GpuTimeText = DrawText::Get().CreateTextRun();
+	TextStatisticsText = DrawText::Get().CreateTextRun();
 
-	RandomContext random(0);
-
-	Array<Hlsl::Sphere> spheres(&GlobalAllocator::Get());
-
-	for (int32 a = -10; a < 10; ++a)
-	{
-		for (int32 b = -10; b < 10; ++b)
-		{
-			const float materialChoice = random.Float01();
-			const Vector position = Vector { static_cast<float>(a) + 0.9f * random.Float01(), 0.2f, static_cast<float>(b) + 0.9f * random.Float01() };
-
-			Hlsl::MaterialType type;
-			Float3 albedo = Float3 { 0.0f, 0.0f, 0.0f };
-			float refractionIndex = 0.0f;
-
-			if ((position - Vector { +4.0f, +0.2f, +0.0f }).GetMagnitude() > 0.9f)
-			{
-				if (materialChoice < 0.8f)
-				{
-					type = Hlsl::MaterialType::Lambertian;
-					albedo = { random.Float01(), random.Float01(), random.Float01() };
-				}
-				else if (materialChoice < 0.95f)
-				{
-					type = Hlsl::MaterialType::Metallic;
-					albedo = { lerp(0.5f, 1.0f, random.Float01()), lerp(0.5f, 1.0f, random.Float01()), lerp(0.5f, 1.0f, random.Float01()) };
-				}
-				else
-				{
-					type = Hlsl::MaterialType::Dielectric;
-					refractionIndex = 1.5f;
-				}
-
-				spheres.Emplace(Float3 { position.X, position.Y, position.Z }, 0.2f, Hlsl::Material { type, albedo, refractionIndex });
-			}
-		}
-	}
-
-	spheres.Emplace(Float3 { 0.0f, -1000.0f, 0.0f }, 1000.0f, Hlsl::Material { Hlsl::MaterialType::Lambertian, Float3 { 0.5f, 0.5f, 0.5f }, 0.0f });
-
-	spheres.Emplace(Float3 { 0.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Dielectric, Float3 { 0.0f, 0.0f, 0.0f }, 1.5f });
-
-	spheres.Emplace(Float3 { -4.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Lambertian, Float3 { 0.4f, 0.2f, 0.1f }, 0.0f });
-
-	spheres.Emplace(Float3 { 4.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Metallic, Float3 { 0.7f, 0.6f, 0.5f }, 0.0f });
+	Array<Hlsl::Sphere>& spheres = scene->Spheres;
+	const Array<Hlsl::BvhNode> bvhNodes = BuildBvh(&spheres);
 
 	SpheresBuffer = Device.CreateBuffer("Spheres Buffer"_view, spheres.GetData(),
 	{
@@ -74,12 +30,22 @@ Raytracer::Raytracer(const Platform::Window* window)
 		.Size = spheres.GetDataSize(),
 		.Stride = spheres.GetElementSize(),
 	});
+	BvhNodesBuffer = Device.CreateBuffer("BVH Nodes Buffer"_view, bvhNodes.GetData(),
+	{
+		.Type = BufferType::StructuredBuffer,
+		.Usage = BufferUsage::Static,
+		.Size = bvhNodes.GetDataSize(),
+		.Stride = bvhNodes.GetElementSize(),
+	});
 }
 
 Raytracer::~Raytracer()
 {
+	Device.DestroyBuffer(&BvhNodesBuffer);
 	Device.DestroyBuffer(&SpheresBuffer);
 
+	DrawText::Get().DestroyTextRun(&TextStatisticsText);
+	DrawText::Get().DestroyTextRun(&GpuTimeText);
 	DrawText::Get().Shutdown();
 
 	DestroyPipelines();
@@ -94,7 +60,16 @@ void Raytracer::Update(const CameraController& cameraController)
 
 	char gpuTimeText[20] = {};
 	Platform::StringPrint("GPU: %.2f mspf", gpuTimeText, sizeof(gpuTimeText), AverageGpuTime * 1000.0);
-	DrawText::Get().Draw(StringView { gpuTimeText, Platform::StringLength(gpuTimeText) }, { 0.0f, 0.0f }, Float3 { 1.0f, 1.0f, 1.0f }, 32.0f);
+	DrawText::Get().UpdateTextRun(GpuTimeText, StringView { gpuTimeText, Platform::StringLength(gpuTimeText) }, { 0.0f, 0.0f }, Float4 { 1.0f, 1.0f, 1.0f, 1.0f }, 32.0f);
+	DrawText::Get().Draw(GpuTimeText);
+
+	const TextStatistics& textStatistics = DrawText::Get().GetStatistics();
+	char textStatisticsText[80] = {};
+	Platform::StringPrint("Text: %zu/%zu characters, %zu KiB uploaded", textStatisticsText, sizeof(textStatisticsText),
+						  textStatistics.Characters, textStatistics.Capacity, textStatistics.UploadedBytes / 1024);
+	DrawText::Get().UpdateTextRun(TextStatisticsText, StringView { textStatisticsText, Platform::StringLength(textStatisticsText) }, { 0.0f, 32.0f },
+								  Float4 { 1.0f, 1.0f, 1.0f, 1.0f }, 16.0f);
+	DrawText::Get().Draw(TextStatisticsText);
 
 	if (IsKeyPressedOnce(Key::R))
 	{
@@ -124,14 +99,45 @@ void Raytracer::Update(const CameraController& cameraController)
 		.Orientation = cameraController.GetOrientation(),
 		.Position = Float3 { position.X, position.Y, position.Z },
 		.FrameIndex = FrameIndex,
-		.OutputTextureIndex = Device.Get(OutputTexture),
+		.MaxDepth = MaxDepth,
+		.SamplesPerPixel = SamplesPerPixel,
+		.AccumulationTextureIndex = Device.Get(AccumulationTexture),
+		.VarianceTextureIndex = Device.Get(VarianceTexture),
+		.NoiseThreshold = NoiseThreshold,
 		.SpheresBufferIndex = Device.Get(SpheresBuffer),
 		.SpheresBufferCount = static_cast<uint32>(SpheresBuffer.GetCount()),
+		.BvhNodesBufferIndex = Device.Get(BvhNodesBuffer),
 	};
 	Graphics.SetRootConstants(&rootConstants);
 
 	Graphics.Dispatch((frameTexture.GetWidth() + 7) / 8, (frameTexture.GetHeight() + 7) / 8, 1);
 
+	Graphics.TextureBarrier
+	(
+		{ BarrierStage::ComputeShading, BarrierStage::ComputeShading },
+		{ BarrierAccess::UnorderedAccess, BarrierAccess::UnorderedAccess },
+		{ BarrierLayout::GraphicsQueueUnorderedAccess, BarrierLayout::GraphicsQueueUnorderedAccess },
+		AccumulationTexture
+	);
+	Graphics.TextureBarrier
+	(
+		{ BarrierStage::ComputeShading, BarrierStage::ComputeShading },
+		{ BarrierAccess::UnorderedAccess, BarrierAccess::UnorderedAccess },
+		{ BarrierLayout::GraphicsQueueUnorderedAccess, BarrierLayout::GraphicsQueueUnorderedAccess },
+		VarianceTexture
+	);
+
+	Graphics.SetPipeline(&ResolvePipeline);
+
+	const Hlsl::ResolveRootConstants resolveRootConstants =
+	{
+		.AccumulationTextureIndex = Device.Get(AccumulationTexture),
+		.OutputTextureIndex = Device.Get(OutputTexture),
+	};
+	Graphics.SetRootConstants(&resolveRootConstants);
+
+	Graphics.Dispatch((frameTexture.GetWidth() + 7) / 8, (frameTexture.GetHeight() + 7) / 8, 1);
+
 	Graphics.TextureBarrier
 	(
 		{ BarrierStage::ComputeShading, BarrierStage::Copy },
@@ -210,10 +216,22 @@ void Raytracer::CreatePipelines()
 		.Stage = traceShader,
 	});
 	Device.DestroyShader(&traceShader);
+
+	Shader resolveShader = Device.CreateShader(
+	{
+		.Stage = ShaderStage::Compute,
+		.FilePath = "Shaders/Resolve.hlsl"_view,
+	});
+	ResolvePipeline = Device.CreatePipeline("Resolve Pipeline"_view,
+	{
+		.Stage = resolveShader,
+	});
+	Device.DestroyShader(&resolveShader);
 }
 
 void Raytracer::DestroyPipelines()
 {
+	Device.DestroyPipeline(&ResolvePipeline);
 	Device.DestroyPipeline(&TracePipeline);
 }
 
@@ -243,6 +261,28 @@ void Raytracer::CreateScreenTextures(uint32 width, uint32 height)
 		.RenderTarget = false,
 		.Storage = true,
 	});
+	AccumulationTexture = Device.CreateTexture("Accumulation Texture"_view, BarrierLayout::GraphicsQueueUnorderedAccess,
+	{
+		.Width = width,
+		.Height = height,
+		.Type = TextureType::Rectangle,
+		.Format = TextureFormat::Rgba32Float,
+		.MipMapCount = 1,
+		.RenderTarget = false,
+		.Storage = true,
+	});
+	// Only the red channel holds the running sum of squared luminance, but the RHI has no single channel float format
+	// and Rgba32Float is the only float format it can bind for unordered access.
+	VarianceTexture = Device.CreateTexture("Variance Texture"_view, BarrierLayout::GraphicsQueueUnorderedAccess,
+	{
+		.Width = width,
+		.Height = height,
+		.Type = TextureType::Rectangle,
+		.Format = TextureFormat::Rgba32Float,
+		.MipMapCount = 1,
+		.RenderTarget = false,
+		.Storage = true,
+	});
 }
 
 void Raytracer::DestroyScreenTextures()
@@ -252,4 +292,6 @@ void Raytracer::DestroyScreenTextures()
 		Device.DestroyTexture(&SwapChainTexture);
 	}
 	Device.DestroyTexture(&OutputTexture);
+	Device.DestroyTexture(&AccumulationTexture);
+	Device.DestroyTexture(&VarianceTexture);
 }
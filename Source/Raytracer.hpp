@@ -1,5 +1,8 @@
 #pragma once
 
+#include "DrawText.hpp"
+#include "Trace.hpp"
+
 #include "RHI/GpuDevice.hpp"
 
 #include "Luft/Base.hpp"
@@ -7,54 +10,12 @@
 #include "Luft/NoCopy.hpp"
 
 class CameraController;
-
-namespace Hlsl
-{
-
-enum class MaterialType : uint32
-{
-	Lambertian,
-	Metallic,
-	Dielectric,
-};
-
-struct Material
-{
-	MaterialType Type;
-
-	Float3 Albedo;
-
-	float RefractionIndex;
-};
-
-struct Sphere
-{
-	Float3 Position;
-	float Radius;
-	Material Material;
-};
-
-struct TraceRootConstants
-{
-	Matrix Orientation;
-	Float3 Position;
-
-	uint32 FrameIndex;
-
-	uint32 OutputTextureIndex;
-
-	uint32 SpheresBufferIndex;
-	uint32 SpheresBufferCount;
-
-	PAD(172);
-};
-
-}
+struct Scene;
 
 class Raytracer : public NoCopy
 {
 public:
-	explicit Raytracer(const Platform::Window* window);
+	Raytracer(const Platform::Window* window, Scene* scene);
 	~Raytracer();
 
 	void Update(const CameraController& cameraController);
@@ -72,13 +33,25 @@ private:
 	GraphicsContext Graphics;
 
 	ComputePipeline TracePipeline;
+	ComputePipeline ResolvePipeline;
 
 	Texture SwapChainTextures[FramesInFlight];
 	Texture OutputTexture;
+	Texture AccumulationTexture;
+	Texture VarianceTexture;
 
 	Buffer SpheresBuffer;
+	Buffer BvhNodesBuffer;
 
 	uint32 FrameIndex;
 
+	uint32 MaxDepth;
+	uint32 SamplesPerPixel;
+	float NoiseThreshold;
+
 	double AverageGpuTime;
+
+	// Laid out again only when their text changes.
+	TextRun GpuTimeText;
+	TextRun TextStatisticsText;
 };
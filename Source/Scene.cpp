@@ -0,0 +1,331 @@
+#include "Scene.hpp"
+#include "JSON.hpp"
+#include "ThreadPool.hpp"
+
+#include "Luft/Random.hpp"
+
+static constexpr uint32 DefaultMaxDepth = 10;
+static constexpr uint32 DefaultSamplesPerPixel = 1;
+static constexpr float DefaultNoiseThreshold = 0.01f;
+
+static const SceneCamera DefaultCamera =
+{
+	.Position = Vector { +13.0f, +2.0f, +3.0f },
+	.YawRadians = 0.0f,
+	.PitchRadians = 0.0f,
+};
+
+Scene CreateDemoScene()
+{
+	const auto lerp = [](float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	};
+
+	RandomContext random(0);
+
+	Array<Hlsl::Sphere> spheres(&GlobalAllocator::Get());
+
+	for (int32 a = -10; a < 10; ++a)
+	{
+		for (int32 b = -10; b < 10; ++b)
+		{
+			const float materialChoice = random.Float01();
+			const Vector position = Vector { static_cast<float>(a) + 0.9f * random.Float01(), 0.2f, static_cast<float>(b) + 0.9f * random.Float01() };
+
+			Hlsl::MaterialType type;
+			Float3 albedo = Float3 { 0.0f, 0.0f, 0.0f };
+			float refractionIndex = 0.0f;
+
+			if ((position - Vector { +4.0f, +0.2f, +0.0f }).GetMagnitude() > 0.9f)
+			{
+				if (materialChoice < 0.8f)
+				{
+					type = Hlsl::MaterialType::Lambertian;
+					albedo = { random.Float01(), random.Float01(), random.Float01() };
+				}
+				else if (materialChoice < 0.95f)
+				{
+					type = Hlsl::MaterialType::Metallic;
+					albedo = { lerp(0.5f, 1.0f, random.Float01()), lerp(0.5f, 1.0f, random.Float01()), lerp(0.5f, 1.0f, random.Float01()) };
+				}
+				else
+				{
+					type = Hlsl::MaterialType::Dielectric;
+					refractionIndex = 1.5f;
+				}
+
+				spheres.Emplace(Float3 { position.X, position.Y, position.Z }, 0.2f, Hlsl::Material { type, albedo, refractionIndex });
+			}
+		}
+	}
+
+	spheres.Emplace(Float3 { 0.0f, -1000.0f, 0.0f }, 1000.0f, Hlsl::Material { Hlsl::MaterialType::Lambertian, Float3 { 0.5f, 0.5f, 0.5f }, 0.0f });
+
+	spheres.Emplace(Float3 { 0.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Dielectric, Float3 { 0.0f, 0.0f, 0.0f }, 1.5f });
+
+	spheres.Emplace(Float3 { -4.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Lambertian, Float3 { 0.4f, 0.2f, 0.1f }, 0.0f });
+
+	spheres.Emplace(Float3 { 4.0f, 1.0f, 0.0f }, 1.0f, Hlsl::Material { Hlsl::MaterialType::Metallic, Float3 { 0.7f, 0.6f, 0.5f }, 0.0f });
+
+	return Scene
+	{
+		.Spheres = Move(spheres),
+		.Camera = DefaultCamera,
+		.MaxDepth = DefaultMaxDepth,
+		.SamplesPerPixel = DefaultSamplesPerPixel,
+		.NoiseThreshold = DefaultNoiseThreshold,
+	};
+}
+
+static Float3 ReadFloat3(JsonCursor* cursor)
+{
+	Float3 result = {};
+	float* elements[] = { &result.X, &result.Y, &result.Z };
+
+	usize count = 0;
+	cursor->BeginArray();
+	while (cursor->NextElement())
+	{
+		VERIFY(count < ARRAY_COUNT(elements), "Expected three components in scene vector!");
+		*elements[count++] = static_cast<float>(cursor->ReadDecimal());
+	}
+	VERIFY(count == ARRAY_COUNT(elements), "Expected three components in scene vector!");
+	return result;
+}
+
+static uint32 ReadUint32(JsonCursor* cursor)
+{
+	const double value = cursor->ReadDecimal();
+	VERIFY(value >= 0.0 && value <= static_cast<double>(0xFFFFFFFFu), "Expected an unsigned integer in scene!");
+	return static_cast<uint32>(value);
+}
+
+static void ReadCamera(JsonCursor* cursor, SceneCamera* camera)
+{
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "position"_view)
+		{
+			const Float3 position = ReadFloat3(cursor);
+			camera->Position = Vector { position.X, position.Y, position.Z };
+		}
+		else if (key == "yaw"_view)
+		{
+			camera->YawRadians = static_cast<float>(cursor->ReadDecimal()) * DegreesToRadians;
+		}
+		else if (key == "pitch"_view)
+		{
+			camera->PitchRadians = static_cast<float>(cursor->ReadDecimal()) * DegreesToRadians;
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
+	}
+}
+
+static void ReadSettings(JsonCursor* cursor, Scene* scene)
+{
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "maxDepth"_view)
+		{
+			scene->MaxDepth = ReadUint32(cursor);
+			VERIFY(scene->MaxDepth != 0, "Scene max depth must be at least one!");
+		}
+		else if (key == "samplesPerPixel"_view)
+		{
+			scene->SamplesPerPixel = ReadUint32(cursor);
+			VERIFY(scene->SamplesPerPixel != 0, "Scene samples per pixel must be at least one!");
+		}
+		else if (key == "noiseThreshold"_view)
+		{
+			scene->NoiseThreshold = static_cast<float>(cursor->ReadDecimal());
+			VERIFY(scene->NoiseThreshold >= 0.0f, "Scene noise threshold must not be negative!");
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
+	}
+}
+
+static Hlsl::Material ReadMaterial(JsonCursor* cursor)
+{
+	Hlsl::Material material = { Hlsl::MaterialType::Lambertian, Float3 { 0.5f, 0.5f, 0.5f }, 0.0f };
+
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "type"_view)
+		{
+			const StringView type = cursor->ReadString();
+			if (type == "lambertian"_view)
+			{
+				material.Type = Hlsl::MaterialType::Lambertian;
+			}
+			else if (type == "metallic"_view)
+			{
+				material.Type = Hlsl::MaterialType::Metallic;
+			}
+			else if (type == "dielectric"_view)
+			{
+				material.Type = Hlsl::MaterialType::Dielectric;
+			}
+			else
+			{
+				VERIFY(false, "Unknown scene material type!");
+			}
+		}
+		else if (key == "albedo"_view)
+		{
+			material.Albedo = ReadFloat3(cursor);
+		}
+		else if (key == "refractionIndex"_view)
+		{
+			material.RefractionIndex = static_cast<float>(cursor->ReadDecimal());
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
+	}
+	return material;
+}
+
+static void ReadSphere(JsonCursor* cursor, Hlsl::Sphere* sphere, uint32* materialIndex)
+{
+	cursor->BeginObject();
+	StringView key;
+	while (cursor->NextMember(&key))
+	{
+		if (key == "position"_view)
+		{
+			sphere->Position = ReadFloat3(cursor);
+		}
+		else if (key == "radius"_view)
+		{
+			sphere->Radius = static_cast<float>(cursor->ReadDecimal());
+		}
+		else if (key == "material"_view)
+		{
+			*materialIndex = ReadUint32(cursor);
+		}
+		else
+		{
+			cursor->SkipValue();
+		}
+	}
+	VERIFY(sphere->Radius > 0.0f, "Scene sphere radius must be positive!");
+}
+
+// The spheres and material references read from one run of the spheres array.
+struct SphereRun
+{
+	Array<Hlsl::Sphere> Spheres;
+	Array<uint32> MaterialIndices;
+};
+
+// Large scenes are almost entirely spheres, so runs of the array are read on every thread and then joined in file order.
+static void ReadSpheres(JsonCursor* cursor, Array<Hlsl::Sphere>* spheres, Array<uint32>* materialIndices)
+{
+	static constexpr usize minimumSpheresPerRun = 1024;
+
+	ThreadPool& threadPool = ThreadPool::Get();
+
+	Array<JsonCursor> runCursors(&GlobalAllocator::Get());
+	cursor->SplitArray(minimumSpheresPerRun, threadPool.GetThreadCount() * 4, &runCursors);
+
+	Array<SphereRun> runs(&GlobalAllocator::Get());
+	for (usize run = 0; run < runCursors.GetLength(); ++run)
+	{
+		runs.Add(SphereRun { Array<Hlsl::Sphere> { &GlobalAllocator::Get() }, Array<uint32> { &GlobalAllocator::Get() } });
+	}
+
+	threadPool.ParallelFor(runCursors.GetLength(), [&runCursors, &runs](usize run, usize)
+	{
+		JsonCursor* runCursor = &runCursors[run];
+		while (runCursor->NextElement())
+		{
+			Hlsl::Sphere sphere = {};
+			uint32 materialIndex = 0;
+			ReadSphere(runCursor, &sphere, &materialIndex);
+
+			runs[run].Spheres.Add(sphere);
+			runs[run].MaterialIndices.Add(materialIndex);
+		}
+	});
+
+	for (const SphereRun& run : runs)
+	{
+		for (usize i = 0; i < run.Spheres.GetLength(); ++i)
+		{
+			spheres->Add(run.Spheres[i]);
+			materialIndices->Add(run.MaterialIndices[i]);
+		}
+	}
+}
+
+Scene LoadScene(StringView filePath)
+{
+	Scene scene =
+	{
+		.Spheres = Array<Hlsl::Sphere> { &GlobalAllocator::Get() },
+		.Camera = DefaultCamera,
+		.MaxDepth = DefaultMaxDepth,
+		.SamplesPerPixel = DefaultSamplesPerPixel,
+		.NoiseThreshold = DefaultNoiseThreshold,
+	};
+
+	const JsonTapeFile file(filePath);
+
+	// Spheres may come before the materials they reference, so indices are resolved once the whole file is read.
+	Array<Hlsl::Material> materials(&GlobalAllocator::Get());
+	Array<uint32> materialIndices(&GlobalAllocator::Get());
+
+	JsonCursor cursor = file.GetCursor();
+	cursor.BeginObject();
+	StringView key;
+	while (cursor.NextMember(&key))
+	{
+		if (key == "camera"_view)
+		{
+			ReadCamera(&cursor, &scene.Camera);
+		}
+		else if (key == "settings"_view)
+		{
+			ReadSettings(&cursor, &scene);
+		}
+		else if (key == "materials"_view)
+		{
+			cursor.BeginArray();
+			while (cursor.NextElement())
+			{
+				materials.Add(ReadMaterial(&cursor));
+			}
+		}
+		else if (key == "spheres"_view)
+		{
+			ReadSpheres(&cursor, &scene.Spheres, &materialIndices);
+		}
+		else
+		{
+			cursor.SkipValue();
+		}
+	}
+
+	VERIFY(!scene.Spheres.IsEmpty(), "Scene has no spheres!");
+	for (usize i = 0; i < scene.Spheres.GetLength(); ++i)
+	{
+		VERIFY(materialIndices[i] < materials.GetLength(), "Scene sphere references a missing material!");
+		scene.Spheres[i].Material = materials[materialIndices[i]];
+	}
+
+	return scene;
+}
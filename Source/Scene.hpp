@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Trace.hpp"
+
+#include "Luft/Array.hpp"
+#include "Luft/Math.hpp"
+#include "Luft/String.hpp"
+
+struct SceneCamera
+{
+	Vector Position;
+	float YawRadians;
+	float PitchRadians;
+};
+
+struct Scene
+{
+	Array<Hlsl::Sphere> Spheres;
+
+	SceneCamera Camera;
+
+	uint32 MaxDepth;
+	uint32 SamplesPerPixel;
+
+	// Relative error below which a pixel stops taking samples, zero to sample every pixel every frame.
+	float NoiseThreshold;
+};
+
+Scene CreateDemoScene();
+
+// Streams the scene description from a JSON file without building a JsonObject tree, so large sphere lists stay cheap.
+// {
+//     "camera": { "position": [x, y, z], "yaw": degrees, "pitch": degrees },
+//     "settings": { "maxDepth": 10, "samplesPerPixel": 1, "noiseThreshold": 0.01 },
+//     "materials": [ { "type": "lambertian" | "metallic" | "dielectric", "albedo": [r, g, b], "refractionIndex": 1.5 } ],
+//     "spheres": [ { "position": [x, y, z], "radius": r, "material": index } ]
+// }
+// At least one sphere is required, along with the materials the spheres reference. The camera and settings are optional,
+// missing values fall back to the demo scene's.
+Scene LoadScene(StringView filePath);
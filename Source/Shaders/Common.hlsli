@@ -12,6 +12,11 @@ float3 SrgbToLinear(float3 x)
 	return select(x < 0.04045f, x / 12.92f, pow((x + 0.055f) / 1.055f, 2.4f));
 }
 
+float Luminance(float3 color)
+{
+	return dot(color, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
 float3 Reflect(float3 incoming, float3 normal)
 {
 	return incoming - 2.0f * dot(incoming, normal) * normal;
@@ -0,0 +1,30 @@
+#include "Common.hlsli"
+
+struct RootConstants
+{
+	uint AccumulationTextureIndex;
+	uint OutputTextureIndex;
+};
+ConstantBuffer<RootConstants> RootConstants : register(b0);
+
+[numthreads(8, 8, 1)]
+void ComputeStart(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	const RWTexture2D<float4> accumulationTexture = ResourceDescriptorHeap[RootConstants.AccumulationTextureIndex];
+	const RWTexture2D<float3> outputTexture = ResourceDescriptorHeap[RootConstants.OutputTextureIndex];
+
+	uint outputTextureWidth;
+	uint outputTextureHeight;
+	outputTexture.GetDimensions(outputTextureWidth, outputTextureHeight);
+
+	if (dispatchThreadID.x >= outputTextureWidth || dispatchThreadID.y >= outputTextureHeight)
+	{
+		return;
+	}
+
+	// The accumulation texture holds the running sum of linear samples in rgb and the sample count in a.
+	const float4 accumulated = accumulationTexture[dispatchThreadID.xy];
+	const float3 color = accumulated.a > 0.0f ? accumulated.rgb / accumulated.a : 0.0f;
+
+	outputTexture[dispatchThreadID.xy] = LinearToSrgb(saturate(color));
+}
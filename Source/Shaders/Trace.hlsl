@@ -1,13 +1,17 @@
 #include "Common.hlsli"
 
-static const uint SamplesPerPixel = 1;
-static const uint MaxDepth = 10;
+static const uint AdaptiveMinSamples = 16;
+static const uint AdaptiveMaxSamplesPerFrame = 4;
 
 static const float FieldOfViewYRadians = Pi / 9.0f;
 static const float FocalLength = 1.0f;
 
 static const float3 BackgroundColor = float3(0.4f, 0.6f, 0.9f);
 
+static const uint BvhMaxDepth = 32;
+static const uint BvhLeafCountMask = 0xFFFF;
+static const uint BvhAxisShift = 16;
+
 struct RootConstants
 {
 	matrix Orientation;
@@ -15,10 +19,18 @@ struct RootConstants
 
 	uint FrameIndex;
 
-	uint OutputTextureIndex;
+	uint MaxDepth;
+	uint SamplesPerPixel;
+
+	uint AccumulationTextureIndex;
+	uint VarianceTextureIndex;
+
+	float NoiseThreshold;
 
 	uint SpheresBuffer;
 	uint SpheresBufferCount;
+
+	uint BvhNodesBuffer;
 };
 ConstantBuffer<RootConstants> RootConstants : register(b0);
 
@@ -47,6 +59,14 @@ struct Sphere
 	Material Material;
 };
 
+struct BvhNode
+{
+	float3 Minimum;
+	uint Offset;
+	float3 Maximum;
+	uint CountAndAxis;
+};
+
 struct Hit
 {
 	float Time;
@@ -94,6 +114,67 @@ Hit RaySphere(float3 rayOrigin, float3 rayDirection, float rayMinT, float rayMax
 	return hit;
 }
 
+bool RayBounds(BvhNode node, float3 rayOrigin, float3 inverseRayDirection, float rayMinT, float rayMaxT)
+{
+	const float3 t0 = (node.Minimum - rayOrigin) * inverseRayDirection;
+	const float3 t1 = (node.Maximum - rayOrigin) * inverseRayDirection;
+	const float3 near = min(t0, t1);
+	const float3 far = max(t0, t1);
+
+	const float entry = max(max(near.x, near.y), max(near.z, rayMinT));
+	const float exit = min(min(far.x, far.y), min(far.z, rayMaxT));
+	return entry <= exit;
+}
+
+Hit TraverseBvh(StructuredBuffer<BvhNode> nodes, StructuredBuffer<Sphere> spheres, float3 rayOrigin, float3 rayDirection, float rayMinT, float rayMaxT)
+{
+	Hit hit = (Hit)0;
+	hit.Time = -1.0f;
+
+	const float3 inverseRayDirection = 1.0f / rayDirection;
+
+	uint stack[BvhMaxDepth];
+	uint stackSize = 0;
+	uint nodeIndex = 0;
+
+	while (true)
+	{
+		const BvhNode node = nodes[nodeIndex];
+		if (RayBounds(node, rayOrigin, inverseRayDirection, rayMinT, rayMaxT))
+		{
+			const uint count = node.CountAndAxis & BvhLeafCountMask;
+			if (count != 0)
+			{
+				for (uint i = node.Offset; i < node.Offset + count; ++i)
+				{
+					const Hit potentialHit = RaySphere(rayOrigin, rayDirection, rayMinT, rayMaxT, spheres[i]);
+					if (IsValidHit(potentialHit))
+					{
+						hit = potentialHit;
+						rayMaxT = potentialHit.Time;
+					}
+				}
+			}
+			else
+			{
+				const uint axis = node.CountAndAxis >> BvhAxisShift;
+				const bool directionNegative = rayDirection[axis] < 0.0f;
+				stack[stackSize++] = directionNegative ? nodeIndex + 1 : node.Offset;
+				nodeIndex = directionNegative ? node.Offset : nodeIndex + 1;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackSize];
+	}
+
+	return hit;
+}
+
 void Scatter(inout uint rngState, inout float3 rayDirection, inout float3 attenuation, Hit hit)
 {
 	switch (hit.Material.Type)
@@ -138,19 +219,60 @@ void Scatter(inout uint rngState, inout float3 rayDirection, inout float3 attenu
 	}
 }
 
+// Relative standard error of the mean luminance, estimated from the running sums of the samples and their squares.
+float RelativeError(float4 accumulated, float luminanceSquaredSum)
+{
+	const float count = accumulated.a;
+	const float mean = Luminance(accumulated.rgb) / count;
+	const float variance = max(luminanceSquaredSum / count - mean * mean, 0.0f);
+	return sqrt(variance / count) / max(mean, 1e-3f);
+}
+
+// Converged pixels get no samples and noisy ones get more, in proportion to how far they are from the threshold.
+uint GetSampleCount(float4 accumulated, float luminanceSquaredSum)
+{
+	if (RootConstants.NoiseThreshold <= 0.0f || accumulated.a < AdaptiveMinSamples)
+	{
+		return RootConstants.SamplesPerPixel;
+	}
+
+	const float error = RelativeError(accumulated, luminanceSquaredSum);
+	if (error <= RootConstants.NoiseThreshold)
+	{
+		return 0;
+	}
+	return RootConstants.SamplesPerPixel * clamp((uint)ceil(error / RootConstants.NoiseThreshold), 1, AdaptiveMaxSamplesPerFrame);
+}
+
 [numthreads(8, 8, 1)]
 void ComputeStart(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
 	const uint x = dispatchThreadID.x;
 	const uint y = dispatchThreadID.y;
 
-	const RWTexture2D<float3> outputTexture = ResourceDescriptorHeap[RootConstants.OutputTextureIndex];
+	const RWTexture2D<float4> accumulationTexture = ResourceDescriptorHeap[RootConstants.AccumulationTextureIndex];
+	const RWTexture2D<float4> varianceTexture = ResourceDescriptorHeap[RootConstants.VarianceTextureIndex];
 
 	const StructuredBuffer<Sphere> spheres = ResourceDescriptorHeap[RootConstants.SpheresBuffer];
+	const StructuredBuffer<BvhNode> bvhNodes = ResourceDescriptorHeap[RootConstants.BvhNodesBuffer];
 
 	uint outputTextureWidth;
 	uint outputTextureHeight;
-	outputTexture.GetDimensions(outputTextureWidth, outputTextureHeight);
+	accumulationTexture.GetDimensions(outputTextureWidth, outputTextureHeight);
+
+	if (x >= outputTextureWidth || y >= outputTextureHeight)
+	{
+		return;
+	}
+
+	const float4 previous = RootConstants.FrameIndex == 0 ? 0.0f : accumulationTexture[uint2(x, y)];
+	const float previousLuminanceSquared = RootConstants.FrameIndex == 0 ? 0.0f : varianceTexture[uint2(x, y)].x;
+
+	const uint sampleCount = GetSampleCount(previous, previousLuminanceSquared);
+	if (sampleCount == 0)
+	{
+		return;
+	}
 
 	const uint dispatchThreadIndex = y * outputTextureWidth + x;
 
@@ -177,7 +299,8 @@ void ComputeStart(uint3 dispatchThreadID : SV_DispatchThreadID)
 	const float3 viewportTopLeft = RootConstants.Position - (FocalLength * cameraZ) - (viewportX / 2.0f) - (viewportY / 2.0f);
 
 	float3 samples = 0.0f;
-	for (uint i = 0; i < SamplesPerPixel; ++i)
+	float luminanceSquared = 0.0f;
+	for (uint i = 0; i < sampleCount; ++i)
 	{
 		const float2 sampleOffset = float2(Random01(rngState) - 0.5f, Random01(rngState) - 0.5f);
 		const float3 viewportPixel = viewportTopLeft + pixelCenter + viewportDeltaX * (x + sampleOffset.x) + viewportDeltaY * (y + sampleOffset.y);
@@ -187,21 +310,9 @@ void ComputeStart(uint3 dispatchThreadID : SV_DispatchThreadID)
 		uint depth = 0;
 
 		float3 color = BackgroundColor;
-		while (depth != MaxDepth)
+		while (depth != RootConstants.MaxDepth)
 		{
-			Hit hit = (Hit)0;
-			hit.Time = -1.0f;
-			for (uint j = 0; j < RootConstants.SpheresBufferCount; ++j)
-			{
-				const Sphere sphere = spheres[j];
-
-				const Hit potentialHit = RaySphere(rayOrigin, rayDirection, 0.001f, Infinity, sphere);
-				const bool closer = potentialHit.Time < hit.Time;
-				if (IsValidHit(potentialHit) && (closer || !IsValidHit(hit)))
-				{
-					hit = potentialHit;
-				}
-			}
+			const Hit hit = TraverseBvh(bvhNodes, spheres, rayOrigin, rayDirection, 0.001f, Infinity);
 
 			if (IsValidHit(hit))
 			{
@@ -216,11 +327,9 @@ void ComputeStart(uint3 dispatchThreadID : SV_DispatchThreadID)
 			}
 		}
 		samples += color;
+		luminanceSquared += Luminance(color) * Luminance(color);
 	}
 
-	const float3 previousColor = SrgbToLinear(outputTexture[uint2(x, y)]);
-	const float3 newColor = samples / SamplesPerPixel;
-	const float3 accumulatedColor = lerp(previousColor, newColor, 1.0f / (1.0f + RootConstants.FrameIndex));
-
-	outputTexture[uint2(x, y)] = LinearToSrgb(accumulatedColor);
+	accumulationTexture[uint2(x, y)] = previous + float4(samples, sampleCount);
+	varianceTexture[uint2(x, y)] = float4(previousLuminanceSquared + luminanceSquared, 0.0f, 0.0f, 0.0f);
 }
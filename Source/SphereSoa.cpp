@@ -0,0 +1,170 @@
+#include "SphereSoa.hpp"
+#include "BVH.hpp"
+
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+SphereSoa BuildSphereSoa(const Array<Hlsl::Sphere>& spheres)
+{
+	SphereSoa soa =
+	{
+		.PositionX = Array<float> { &GlobalAllocator::Get() },
+		.PositionY = Array<float> { &GlobalAllocator::Get() },
+		.PositionZ = Array<float> { &GlobalAllocator::Get() },
+		.RadiusSquared = Array<float> { &GlobalAllocator::Get() },
+		.Count = spheres.GetLength(),
+	};
+
+	// Pad so that a full vector load starting at any sphere stays inside the arrays.
+	const usize paddedCount = spheres.GetLength() + SphereSoaWidth - 1;
+	soa.PositionX.GrowToLengthUninitialized(paddedCount);
+	soa.PositionY.GrowToLengthUninitialized(paddedCount);
+	soa.PositionZ.GrowToLengthUninitialized(paddedCount);
+	soa.RadiusSquared.GrowToLengthUninitialized(paddedCount);
+
+	for (usize i = 0; i < spheres.GetLength(); ++i)
+	{
+		const Hlsl::Sphere& sphere = spheres[i];
+
+		soa.PositionX[i] = sphere.Position.X;
+		soa.PositionY[i] = sphere.Position.Y;
+		soa.PositionZ[i] = sphere.Position.Z;
+		soa.RadiusSquared[i] = sphere.Radius * sphere.Radius;
+	}
+
+	// Padding lanes are masked off by the count, they only have to hold finite values.
+	for (usize i = spheres.GetLength(); i < paddedCount; ++i)
+	{
+		soa.PositionX[i] = 0.0f;
+		soa.PositionY[i] = 0.0f;
+		soa.PositionZ[i] = 0.0f;
+		soa.RadiusSquared[i] = 0.0f;
+	}
+
+	return soa;
+}
+
+#if defined(__AVX2__)
+
+void IntersectSpheres(const SphereSoa& spheres, usize first, usize count, Vector rayOrigin, Vector rayDirection, float rayMinT, float* rayMaxT, BvhHit* hit)
+{
+	CHECK(rayMaxT && hit);
+	CHECK(first + count <= spheres.Count);
+
+	const float a = rayDirection.Dot(rayDirection);
+
+	const __m256 originX = _mm256_set1_ps(rayOrigin.X);
+	const __m256 originY = _mm256_set1_ps(rayOrigin.Y);
+	const __m256 originZ = _mm256_set1_ps(rayOrigin.Z);
+	const __m256 directionX = _mm256_set1_ps(rayDirection.X);
+	const __m256 directionY = _mm256_set1_ps(rayDirection.Y);
+	const __m256 directionZ = _mm256_set1_ps(rayDirection.Z);
+	const __m256 fourA = _mm256_set1_ps(4.0f * a);
+	const __m256 inverseTwoA = _mm256_set1_ps(1.0f / (2.0f * a));
+	const __m256 minimumT = _mm256_set1_ps(rayMinT);
+	const __m256 laneIndices = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 missed = _mm256_set1_ps(INFINITY);
+
+	__m256 closestT = _mm256_set1_ps(*rayMaxT);
+	__m256 closestIndex = _mm256_set1_ps(-1.0f);
+
+	for (usize i = first; i < first + count; i += SphereSoaWidth)
+	{
+		const __m256 offsetX = _mm256_sub_ps(_mm256_loadu_ps(spheres.PositionX.GetData() + i), originX);
+		const __m256 offsetY = _mm256_sub_ps(_mm256_loadu_ps(spheres.PositionY.GetData() + i), originY);
+		const __m256 offsetZ = _mm256_sub_ps(_mm256_loadu_ps(spheres.PositionZ.GetData() + i), originZ);
+		const __m256 radiusSquared = _mm256_loadu_ps(spheres.RadiusSquared.GetData() + i);
+
+		const __m256 directionDotOffset = _mm256_fmadd_ps(directionX, offsetX, _mm256_fmadd_ps(directionY, offsetY, _mm256_mul_ps(directionZ, offsetZ)));
+		const __m256 b = _mm256_mul_ps(_mm256_set1_ps(-2.0f), directionDotOffset);
+		const __m256 c = _mm256_sub_ps(_mm256_fmadd_ps(offsetX, offsetX, _mm256_fmadd_ps(offsetY, offsetY, _mm256_mul_ps(offsetZ, offsetZ))), radiusSquared);
+		const __m256 discriminant = _mm256_fmsub_ps(b, b, _mm256_mul_ps(fourA, c));
+
+		const __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, _mm256_setzero_ps()));
+		const __m256 negativeB = _mm256_sub_ps(_mm256_setzero_ps(), b);
+		const __m256 firstHit = _mm256_mul_ps(_mm256_sub_ps(negativeB, root), inverseTwoA);
+		const __m256 secondHit = _mm256_mul_ps(_mm256_add_ps(negativeB, root), inverseTwoA);
+
+		const __m256 firstHitValid = _mm256_and_ps(_mm256_cmp_ps(firstHit, minimumT, _CMP_GE_OQ), _mm256_cmp_ps(firstHit, closestT, _CMP_LE_OQ));
+		const __m256 secondHitValid = _mm256_and_ps(_mm256_cmp_ps(secondHit, minimumT, _CMP_GE_OQ), _mm256_cmp_ps(secondHit, closestT, _CMP_LE_OQ));
+
+		__m256 time = _mm256_blendv_ps(_mm256_blendv_ps(missed, secondHit, secondHitValid), firstHit, firstHitValid);
+
+		const __m256 lanes = _mm256_add_ps(laneIndices, _mm256_set1_ps(static_cast<float>(i - first)));
+		const __m256 inRange = _mm256_cmp_ps(lanes, _mm256_set1_ps(static_cast<float>(count)), _CMP_LT_OQ);
+		const __m256 hasRoots = _mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GE_OQ);
+		time = _mm256_blendv_ps(missed, time, _mm256_and_ps(inRange, hasRoots));
+
+		const __m256 closer = _mm256_cmp_ps(time, closestT, _CMP_LT_OQ);
+		closestT = _mm256_blendv_ps(closestT, time, closer);
+		closestIndex = _mm256_blendv_ps(closestIndex, lanes, closer);
+	}
+
+	// Reduce the eight lanes to the nearest hit and find which lane produced it.
+	__m256 minimum = _mm256_min_ps(closestT, _mm256_permute_ps(closestT, _MM_SHUFFLE(2, 3, 0, 1)));
+	minimum = _mm256_min_ps(minimum, _mm256_permute_ps(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+	minimum = _mm256_min_ps(minimum, _mm256_permute2f128_ps(minimum, minimum, 0x01));
+
+	const int32 closestMask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(closestT, minimum, _CMP_EQ_OQ),
+															   _mm256_cmp_ps(closestIndex, _mm256_setzero_ps(), _CMP_GE_OQ)));
+	if (closestMask == 0)
+	{
+		return;
+	}
+
+	float indices[SphereSoaWidth];
+	_mm256_storeu_ps(indices, closestIndex);
+
+	// Ties go to the lowest sphere index, like the scalar loop.
+	float bestIndex = INFINITY;
+	for (usize lane = 0; lane < SphereSoaWidth; ++lane)
+	{
+		if ((closestMask & (1 << lane)) && indices[lane] < bestIndex)
+		{
+			bestIndex = indices[lane];
+		}
+	}
+
+	*rayMaxT = _mm256_cvtss_f32(minimum);
+	*hit = BvhHit { *rayMaxT, static_cast<uint32>(first + static_cast<usize>(bestIndex)) };
+}
+
+#else
+
+void IntersectSpheres(const SphereSoa& spheres, usize first, usize count, Vector rayOrigin, Vector rayDirection, float rayMinT, float* rayMaxT, BvhHit* hit)
+{
+	CHECK(rayMaxT && hit);
+	CHECK(first + count <= spheres.Count);
+
+	const float a = rayDirection.Dot(rayDirection);
+
+	for (usize i = first; i < first + count; ++i)
+	{
+		const Vector offset = Vector { spheres.PositionX[i], spheres.PositionY[i], spheres.PositionZ[i] } - rayOrigin;
+		const float b = -2.0f * rayDirection.Dot(offset);
+		const float c = offset.Dot(offset) - spheres.RadiusSquared[i];
+		const float discriminant = b * b - 4.0f * a * c;
+		if (discriminant < 0.0f)
+		{
+			continue;
+		}
+
+		const float firstHit = (-b - sqrtf(discriminant)) / (2.0f * a);
+		const float secondHit = (-b + sqrtf(discriminant)) / (2.0f * a);
+
+		const bool firstHitValid = firstHit >= rayMinT && firstHit <= *rayMaxT;
+		const bool secondHitValid = secondHit >= rayMinT && secondHit <= *rayMaxT;
+
+		const float time = firstHitValid ? firstHit : (secondHitValid ? secondHit : INFINITY);
+		if (time < *rayMaxT)
+		{
+			*rayMaxT = time;
+			*hit = BvhHit { time, static_cast<uint32>(i) };
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Trace.hpp"
+
+#include "Luft/Array.hpp"
+
+struct BvhHit;
+
+static constexpr usize SphereSoaWidth = 8;
+
+// Structure-of-arrays copy of the sphere positions and radii for the SIMD intersection kernel.
+// Materials stay in the Hlsl::Sphere array and are only fetched for the closest hit.
+struct SphereSoa
+{
+	Array<float> PositionX;
+	Array<float> PositionY;
+	Array<float> PositionZ;
+	Array<float> RadiusSquared;
+
+	usize Count;
+};
+
+SphereSoa BuildSphereSoa(const Array<Hlsl::Sphere>& spheres);
+
+// Tests one ray against the spheres [first, first + count), SphereSoaWidth at a time.
+// Only hits closer than the incoming rayMaxT replace the current closest hit.
+void IntersectSpheres(const SphereSoa& spheres, usize first, usize count, Vector rayOrigin, Vector rayDirection, float rayMinT, float* rayMaxT, BvhHit* hit);
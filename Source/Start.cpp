@@ -1,5 +1,7 @@
 #include "CameraController.hpp"
+#include "CommandLine.hpp"
 #include "Raytracer.hpp"
+#include "Scene.hpp"
 
 #include "Luft/Platform.hpp"
 
@@ -10,16 +12,35 @@ static void ResizeHandler(Platform::Window*)
 	NeedsResize = true;
 }
 
+static Scene LoadStartupScene()
+{
+	const Array<StringView> arguments = GetCommandLineArguments();
+
+	const StringView scenePath = FindCommandLineValue(arguments, "--scene"_view);
+	Scene scene = scenePath.IsEmpty() ? CreateDemoScene() : LoadScene(scenePath);
+
+	double noiseThreshold = 0.0;
+	const StringView noise = FindCommandLineValue(arguments, "--noise"_view);
+	if (!noise.IsEmpty() && ParseCommandLineDouble(noise, &noiseThreshold) && noiseThreshold >= 0.0)
+	{
+		scene.NoiseThreshold = static_cast<float>(noiseThreshold);
+	}
+	return scene;
+}
+
 void Start()
 {
+	Scene scene = LoadStartupScene();
+
 	Platform::Window* window = Platform::MakeWindow("Eos", 1280, 720);
 
 	Platform::ShowWindow(window);
 	Platform::InstallResizeHandler(ResizeHandler);
 
-	Raytracer raytracer(window);
+	Raytracer raytracer(window, &scene);
 
 	CameraController cameraController;
+	cameraController.SetView(scene.Camera.Position, scene.Camera.YawRadians, scene.Camera.PitchRadians);
 
 	double timeLast = 0.0;
 
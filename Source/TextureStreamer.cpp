@@ -0,0 +1,234 @@
+#include "TextureStreamer.hpp"
+
+// Mips up to this size are read regardless of the budget, so that every texture has something to draw with.
+static constexpr usize MipTailSize = 64 * 1024;
+
+struct TextureStreamer::StreamedTexture
+{
+	Array<char> FilePath;
+
+	// Owned by the I/O thread, and closed once the texture is done.
+	FileReader File;
+
+	DdsImage Image;
+	bool IsOpen;
+
+	// Owned by the I/O thread. Mips are read counting down from the smallest, until the last or the budget runs out.
+	uint32 NextMipMap;
+	bool IsDone;
+
+	uint32 ResidentMipMap;
+};
+
+static usize GetMipMapSize(const DdsImage& image, uint32 mipMap)
+{
+	usize size = 0;
+	for (uint32 arrayLayer = 0; arrayLayer < image.ArraySize; ++arrayLayer)
+	{
+		size += image.GetSubresource(mipMap, arrayLayer).SlicePitch;
+	}
+	return size;
+}
+
+TextureStreamer::TextureStreamer(usize memoryBudget)
+	: MemoryBudget(memoryBudget)
+	, ResidentSize(0)
+	, PendingSize(0)
+	, Quit(false)
+	, IoThread([this]()
+	{
+		IoLoop();
+	})
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		const std::lock_guard lock(Mutex);
+		Quit = true;
+	}
+	WorkAvailable.notify_all();
+	IoThread.join();
+
+	for (const StreamedMipMap& mipMap : Published)
+	{
+		GlobalAllocator::Get().Deallocate(mipMap.Data, mipMap.Size);
+	}
+
+	for (StreamedTexture* texture : Textures)
+	{
+		UnloadDdsImage(&texture->Image);
+		texture->~StreamedTexture();
+		GlobalAllocator::Get().Deallocate(texture, sizeof(*texture));
+	}
+}
+
+uint32 TextureStreamer::Request(StringView filePath)
+{
+	StreamedTexture* texture = GlobalAllocator::Get().Create<StreamedTexture>();
+	for (usize i = 0; i < filePath.GetLength(); ++i)
+	{
+		texture->FilePath.Add(filePath[i]);
+	}
+	texture->IsOpen = false;
+	texture->NextMipMap = 0;
+	texture->IsDone = false;
+	texture->ResidentMipMap = NotResident;
+
+	uint32 index;
+	{
+		const std::lock_guard lock(Mutex);
+		index = static_cast<uint32>(Textures.GetLength());
+		Textures.Add(texture);
+	}
+	WorkAvailable.notify_one();
+	return index;
+}
+
+uint32 TextureStreamer::GetResidentMipMap(uint32 texture) const
+{
+	const std::lock_guard lock(Mutex);
+	return Textures[texture]->ResidentMipMap;
+}
+
+usize TextureStreamer::GetResidentSize() const
+{
+	const std::lock_guard lock(Mutex);
+	return ResidentSize;
+}
+
+const DdsImage& TextureStreamer::GetImage(uint32 texture) const
+{
+	// A texture's image is not written again once its first mip is published.
+	return Textures[texture]->Image;
+}
+
+void TextureStreamer::TakePublished()
+{
+	const std::lock_guard lock(Mutex);
+	CHECK(Uploading.IsEmpty());
+	for (const StreamedMipMap& mipMap : Published)
+	{
+		Uploading.Add(mipMap);
+	}
+	Published.Clear();
+}
+
+void TextureStreamer::FinishUploads()
+{
+	const std::lock_guard lock(Mutex);
+	for (const StreamedMipMap& mipMap : Uploading)
+	{
+		GlobalAllocator::Get().Deallocate(mipMap.Data, mipMap.Size);
+		PendingSize -= mipMap.Size;
+		ResidentSize += mipMap.Size;
+		Textures[mipMap.Texture]->ResidentMipMap = mipMap.MipMap;
+	}
+	Uploading.Clear();
+}
+
+void TextureStreamer::IoLoop()
+{
+	std::unique_lock lock(Mutex);
+	while (!Quit)
+	{
+		// Opening only reads the headers, so every texture is open before any more mips are read.
+		if (OpenNextTexture(&lock) || ReadNextMipMap(&lock))
+		{
+			continue;
+		}
+		WorkAvailable.wait(lock);
+	}
+}
+
+bool TextureStreamer::OpenNextTexture(std::unique_lock<std::mutex>* lock)
+{
+	for (StreamedTexture* texture : Textures)
+	{
+		if (texture->IsOpen)
+		{
+			continue;
+		}
+
+		lock->unlock();
+		const bool opened = texture->File.Open({ texture->FilePath.GetData(), texture->FilePath.GetLength() });
+		VERIFY(opened, "Failed to open texture!");
+
+		char headers[DdsHeadersSize];
+		const bool readHeaders = texture->File.GetSize() >= DdsHeadersSize && texture->File.Read(0, headers, DdsHeadersSize);
+		VERIFY(readHeaders, "Invalid DDS file!");
+
+		DdsImage image = ParseDdsHeaders({ headers, DdsHeadersSize }, texture->File.GetSize());
+		lock->lock();
+
+		texture->Image = Move(image);
+		texture->NextMipMap = texture->Image.MipMapCount - 1;
+		texture->IsOpen = true;
+		return true;
+	}
+	return false;
+}
+
+bool TextureStreamer::ReadNextMipMap(std::unique_lock<std::mutex>* lock)
+{
+	// Smallest first across all textures, which reads every mip tail before the larger mips of any texture.
+	StreamedTexture* next = nullptr;
+	uint32 nextIndex = 0;
+	usize nextSize = 0;
+	for (uint32 i = 0; i < Textures.GetLength(); ++i)
+	{
+		StreamedTexture* texture = Textures[i];
+		if (!texture->IsOpen || texture->IsDone)
+		{
+			continue;
+		}
+
+		const usize size = GetMipMapSize(texture->Image, texture->NextMipMap);
+		if (!next || size < nextSize)
+		{
+			next = texture;
+			nextIndex = i;
+			nextSize = size;
+		}
+	}
+	if (!next)
+	{
+		return false;
+	}
+
+	// Nothing is evicted, so a texture that does not fit now never will.
+	const bool isMipTail = nextSize <= MipTailSize;
+	if (!isMipTail && ResidentSize + PendingSize + nextSize > MemoryBudget)
+	{
+		next->File.Close();
+		next->IsDone = true;
+		return true;
+	}
+
+	const uint32 mipMap = next->NextMipMap;
+	PendingSize += nextSize;
+
+	// Layers are stored one after the other, so each layer's part of the mip is a read of its own.
+	lock->unlock();
+	uint8* data = static_cast<uint8*>(GlobalAllocator::Get().Allocate(nextSize));
+	usize dataOffset = 0;
+	const DdsImage& image = next->Image;
+	for (uint32 arrayLayer = 0; arrayLayer < image.ArraySize; ++arrayLayer)
+	{
+		const DdsSubresource& subresource = image.GetSubresource(mipMap, arrayLayer);
+		const bool read = next->File.Read(DdsHeadersSize + subresource.Offset, data + dataOffset, subresource.SlicePitch);
+		VERIFY(read, "Failed to read texture!");
+		dataOffset += subresource.SlicePitch;
+	}
+	lock->lock();
+
+	Published.Add(StreamedMipMap { nextIndex, mipMap, nextSize, data });
+	if (mipMap == 0)
+	{
+		next->File.Close();
+	}
+	next->IsDone = mipMap == 0;
+	next->NextMipMap = (mipMap == 0) ? 0 : mipMap - 1;
+	return true;
+}
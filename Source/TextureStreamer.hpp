@@ -0,0 +1,85 @@
+#pragma once
+
+#include "DDS.hpp"
+
+#include "Luft/Array.hpp"
+#include "Luft/Base.hpp"
+#include "Luft/NoCopy.hpp"
+#include "Luft/String.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Loads DDS textures on an I/O thread, smallest mips first, so a texture is usable as soon as its mip tail is in and the
+// time to start no longer grows with the size of the textures. The I/O thread reads a texture's headers, then each mip on
+// its own into memory that counts against the budget until it is uploaded, and Update hands it to the thread that owns the
+// device. Mips past the tail are only read while what is resident or waiting to be uploaded stays within the budget.
+class TextureStreamer : public NoCopy
+{
+public:
+	static constexpr uint32 NotResident = ~0u;
+
+	explicit TextureStreamer(usize memoryBudget);
+	~TextureStreamer();
+
+	// Returns straight away, the file is not opened until the I/O thread gets to it.
+	// Request and Update are called from the same thread.
+	uint32 Request(StringView filePath);
+
+	// The most detailed mip uploaded so far, or NotResident before the first.
+	uint32 GetResidentMipMap(uint32 texture) const;
+	bool IsFullyResident(uint32 texture) const { return GetResidentMipMap(texture) == 0; }
+
+	usize GetResidentSize() const;
+
+	// Only valid once a mip of the texture is resident.
+	const DdsImage& GetImage(uint32 texture) const;
+
+	// Calls upload(texture, image, mipMap, data) for every mip read since the last update, in the order they were read. The
+	// image only describes the texture, data holds the mip of every layer one after the other, and is freed once upload
+	// returns. The first call for a texture is always for its smallest mip.
+	template<typename F>
+	void Update(const F& upload)
+	{
+		TakePublished();
+		for (const StreamedMipMap& mipMap : Uploading)
+		{
+			upload(mipMap.Texture, GetImage(mipMap.Texture), mipMap.MipMap, mipMap.Data);
+		}
+		FinishUploads();
+	}
+
+private:
+	struct StreamedTexture;
+
+	struct StreamedMipMap
+	{
+		uint32 Texture;
+		uint32 MipMap;
+		usize Size;
+		uint8* Data;
+	};
+
+	void TakePublished();
+	void FinishUploads();
+
+	void IoLoop();
+	bool OpenNextTexture(std::unique_lock<std::mutex>* lock);
+	bool ReadNextMipMap(std::unique_lock<std::mutex>* lock);
+
+	Array<StreamedTexture*> Textures;
+
+	Array<StreamedMipMap> Published;
+	Array<StreamedMipMap> Uploading;
+
+	usize MemoryBudget;
+	usize ResidentSize;
+	usize PendingSize;
+
+	mutable std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	bool Quit;
+
+	std::thread IoThread;
+};
@@ -0,0 +1,112 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(usize threadCount)
+	: CurrentJob(nullptr)
+	, CurrentContext(nullptr)
+	, CurrentCount(0)
+	, Generation(0)
+	, ActiveWorkers(0)
+	, Quit(false)
+	, NextIndex(0)
+{
+	if (threadCount == 0)
+	{
+		threadCount = Max<usize>(std::thread::hardware_concurrency(), 1);
+	}
+
+	for (usize i = 1; i < threadCount; ++i)
+	{
+		Workers.Emplace([this, i]()
+		{
+			WorkerLoop(i);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard lock(Mutex);
+		Quit = true;
+	}
+	WorkAvailable.notify_all();
+
+	for (std::thread& worker : Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Run(Job job, const void* context, usize count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	{
+		const std::lock_guard lock(Mutex);
+		CHECK(ActiveWorkers == 0);
+
+		CurrentJob = job;
+		CurrentContext = context;
+		CurrentCount = count;
+		NextIndex.store(0, std::memory_order_relaxed);
+
+		ActiveWorkers = Workers.GetLength();
+		++Generation;
+	}
+	WorkAvailable.notify_all();
+
+	Work(0);
+
+	std::unique_lock lock(Mutex);
+	WorkFinished.wait(lock, [this]() { return ActiveWorkers == 0; });
+
+	CurrentJob = nullptr;
+	CurrentContext = nullptr;
+	CurrentCount = 0;
+}
+
+void ThreadPool::Work(usize threadIndex)
+{
+	while (true)
+	{
+		const usize index = NextIndex.fetch_add(1, std::memory_order_relaxed);
+		if (index >= CurrentCount)
+		{
+			break;
+		}
+		CurrentJob(CurrentContext, index, threadIndex);
+	}
+}
+
+void ThreadPool::WorkerLoop(usize threadIndex)
+{
+	uint64 lastGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock lock(Mutex);
+			WorkAvailable.wait(lock, [this, lastGeneration]() { return Quit || Generation != lastGeneration; });
+			if (Quit)
+			{
+				return;
+			}
+			lastGeneration = Generation;
+		}
+
+		Work(threadIndex);
+
+		bool finished;
+		{
+			const std::lock_guard lock(Mutex);
+			--ActiveWorkers;
+			finished = ActiveWorkers == 0;
+		}
+		if (finished)
+		{
+			WorkFinished.notify_one();
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Luft/Array.hpp"
+#include "Luft/Base.hpp"
+#include "Luft/Math.hpp"
+#include "Luft/NoCopy.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class ThreadPool : public NoCopy
+{
+public:
+	explicit ThreadPool(usize threadCount = 0);
+	~ThreadPool();
+
+	static ThreadPool& Get()
+	{
+		static ThreadPool instance;
+		return instance;
+	}
+
+	usize GetThreadCount() const { return Workers.GetLength() + 1; }
+
+	template<typename F>
+	void ParallelFor(usize count, const F& function)
+	{
+		const auto job = [](const void* context, usize index, usize threadIndex)
+		{
+			(*static_cast<const F*>(context))(index, threadIndex);
+		};
+		Run(job, &function, count);
+	}
+
+private:
+	using Job = void(*)(const void* context, usize index, usize threadIndex);
+
+	void Run(Job job, const void* context, usize count);
+	void Work(usize threadIndex);
+	void WorkerLoop(usize threadIndex);
+
+	Array<std::thread> Workers;
+
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkFinished;
+
+	Job CurrentJob;
+	const void* CurrentContext;
+	usize CurrentCount;
+	uint64 Generation;
+	usize ActiveWorkers;
+	bool Quit;
+
+	std::atomic<usize> NextIndex;
+};
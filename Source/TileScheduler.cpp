@@ -0,0 +1,150 @@
+#include "TileScheduler.hpp"
+#include "ThreadPool.hpp"
+
+struct TileScheduler::WorkerQueue
+{
+	std::mutex Mutex;
+
+	Array<uint32> Tiles;
+	usize Head;
+	usize Tail;
+};
+
+TileScheduler::TileScheduler(ThreadPool* threadPool)
+	: Pool(threadPool)
+	, Width(0)
+	, Height(0)
+	, TileCountX(0)
+	, TileCountY(0)
+	, StolenCount(0)
+	, Statistics()
+{
+	CHECK(Pool);
+
+	for (usize i = 0; i < Pool->GetThreadCount(); ++i)
+	{
+		Queues.Add(GlobalAllocator::Get().Create<WorkerQueue>());
+	}
+}
+
+TileScheduler::~TileScheduler()
+{
+	for (WorkerQueue* queue : Queues)
+	{
+		queue->~WorkerQueue();
+		GlobalAllocator::Get().Deallocate(queue, sizeof(*queue));
+	}
+}
+
+void TileScheduler::Run(Job job, const void* context, uint32 width, uint32 height)
+{
+	Width = width;
+	Height = height;
+	TileCountX = (width + TileSize - 1) / TileSize;
+	TileCountY = (height + TileSize - 1) / TileSize;
+
+	const usize tileCount = static_cast<usize>(TileCountX) * TileCountY;
+	const usize queueCount = Queues.GetLength();
+
+	TileCosts.Clear();
+	TileCosts.GrowToLengthUninitialized(tileCount);
+	StolenCount.store(0, std::memory_order_relaxed);
+
+	// Contiguous runs keep each thread on neighbouring rows of the scene while the cost evens out through stealing.
+	for (usize i = 0; i < queueCount; ++i)
+	{
+		WorkerQueue* queue = Queues[i];
+		const usize first = i * tileCount / queueCount;
+		const usize last = (i + 1) * tileCount / queueCount;
+
+		queue->Tiles.Clear();
+		for (usize tileIndex = first; tileIndex < last; ++tileIndex)
+		{
+			queue->Tiles.Add(static_cast<uint32>(tileIndex));
+		}
+		queue->Head = 0;
+		queue->Tail = queue->Tiles.GetLength();
+	}
+
+	const double wallStart = Platform::GetTime();
+
+	Pool->ParallelFor(queueCount, [this, job, context](usize, usize threadIndex)
+	{
+		WorkerLoop(job, context, threadIndex);
+	});
+
+	Statistics = TileStatistics
+	{
+		.TileCount = tileCount,
+		.StolenCount = StolenCount.load(std::memory_order_relaxed),
+		.MinimumSeconds = tileCount ? static_cast<double>(TileCosts[0]) : 0.0,
+		.MaximumSeconds = 0.0,
+		.AverageSeconds = 0.0,
+		.TotalSeconds = 0.0,
+		.WallSeconds = Platform::GetTime() - wallStart,
+	};
+	for (const float cost : TileCosts)
+	{
+		Statistics.MinimumSeconds = Min(Statistics.MinimumSeconds, static_cast<double>(cost));
+		Statistics.MaximumSeconds = Max(Statistics.MaximumSeconds, static_cast<double>(cost));
+		Statistics.TotalSeconds += cost;
+	}
+	Statistics.AverageSeconds = tileCount ? Statistics.TotalSeconds / static_cast<double>(tileCount) : 0.0;
+}
+
+void TileScheduler::WorkerLoop(Job job, const void* context, usize threadIndex)
+{
+	uint32 tileIndex;
+	while (Pop(threadIndex, &tileIndex) || Steal(threadIndex, &tileIndex))
+	{
+		const double start = Platform::GetTime();
+		job(context, GetTile(tileIndex), threadIndex);
+		TileCosts[tileIndex] = static_cast<float>(Platform::GetTime() - start);
+	}
+}
+
+bool TileScheduler::Pop(usize threadIndex, uint32* tileIndex)
+{
+	WorkerQueue* queue = Queues[threadIndex];
+
+	const std::lock_guard lock(queue->Mutex);
+	if (queue->Head == queue->Tail)
+	{
+		return false;
+	}
+	*tileIndex = queue->Tiles[queue->Head++];
+	return true;
+}
+
+bool TileScheduler::Steal(usize threadIndex, uint32* tileIndex)
+{
+	// Thieves take from the far end of a victim's run so they don't contend with its owner.
+	const usize queueCount = Queues.GetLength();
+	for (usize offset = 1; offset < queueCount; ++offset)
+	{
+		WorkerQueue* victim = Queues[(threadIndex + offset) % queueCount];
+
+		const std::lock_guard lock(victim->Mutex);
+		if (victim->Head == victim->Tail)
+		{
+			continue;
+		}
+		*tileIndex = victim->Tiles[--victim->Tail];
+		StolenCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+Tile TileScheduler::GetTile(uint32 tileIndex) const
+{
+	const uint32 x = (tileIndex % TileCountX) * TileSize;
+	const uint32 y = (tileIndex / TileCountX) * TileSize;
+	return Tile
+	{
+		.X = x,
+		.Y = y,
+		.Width = Min(TileSize, Width - x),
+		.Height = Min(TileSize, Height - y),
+	};
+}
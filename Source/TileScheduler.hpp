@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Luft/Array.hpp"
+#include "Luft/NoCopy.hpp"
+
+#include <atomic>
+
+class ThreadPool;
+
+// Matches numthreads(8, 8, 1) in Trace.hlsl.
+static constexpr uint32 TileSize = 8;
+
+struct Tile
+{
+	uint32 X;
+	uint32 Y;
+	uint32 Width;
+	uint32 Height;
+};
+
+struct TileStatistics
+{
+	usize TileCount;
+	usize StolenCount;
+
+	double MinimumSeconds;
+	double MaximumSeconds;
+	double AverageSeconds;
+	double TotalSeconds;
+
+	double WallSeconds;
+};
+
+class TileScheduler : public NoCopy
+{
+public:
+	explicit TileScheduler(ThreadPool* threadPool);
+	~TileScheduler();
+
+	// Splits the image into tiles and runs kernel(tile, threadIndex) on every one of them.
+	// Each thread starts with a contiguous run of tiles and steals from the others once it runs dry.
+	template<typename F>
+	void Run(uint32 width, uint32 height, const F& kernel)
+	{
+		const auto job = [](const void* context, const Tile& tile, usize threadIndex)
+		{
+			(*static_cast<const F*>(context))(tile, threadIndex);
+		};
+		Run(job, &kernel, width, height);
+	}
+
+	const TileStatistics& GetStatistics() const { return Statistics; }
+
+	// Seconds spent in each tile during the last run, in row-major tile order.
+	const Array<float>& GetTileCosts() const { return TileCosts; }
+	uint32 GetTileCountX() const { return TileCountX; }
+	uint32 GetTileCountY() const { return TileCountY; }
+
+private:
+	using Job = void(*)(const void* context, const Tile& tile, usize threadIndex);
+
+	struct WorkerQueue;
+
+	void Run(Job job, const void* context, uint32 width, uint32 height);
+	void WorkerLoop(Job job, const void* context, usize threadIndex);
+
+	bool Pop(usize threadIndex, uint32* tileIndex);
+	bool Steal(usize threadIndex, uint32* tileIndex);
+
+	Tile GetTile(uint32 tileIndex) const;
+
+	ThreadPool* Pool;
+
+	Array<WorkerQueue*> Queues;
+
+	uint32 Width;
+	uint32 Height;
+	uint32 TileCountX;
+	uint32 TileCountY;
+
+	Array<float> TileCosts;
+	std::atomic<usize> StolenCount;
+
+	TileStatistics Statistics;
+};
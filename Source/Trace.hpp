@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Luft/Base.hpp"
+#include "Luft/Math.hpp"
+
+namespace Hlsl
+{
+
+enum class MaterialType : uint32
+{
+	Lambertian,
+	Metallic,
+	Dielectric,
+};
+
+struct Material
+{
+	MaterialType Type;
+
+	Float3 Albedo;
+
+	float RefractionIndex;
+};
+
+struct Sphere
+{
+	Float3 Position;
+	float Radius;
+	Material Material;
+};
+
+static constexpr uint32 BvhMaxDepth = 32;
+static constexpr uint32 BvhLeafCountMask = 0xFFFF;
+static constexpr uint32 BvhAxisShift = 16;
+
+// Nodes are flattened depth-first, so the first child of an interior node directly follows it and Offset holds the second.
+// Leaves store their first sphere in Offset and a non-zero sphere count in the low bits of CountAndAxis.
+struct BvhNode
+{
+	Float3 Minimum;
+	uint32 Offset;
+	Float3 Maximum;
+	uint32 CountAndAxis;
+};
+
+struct TraceRootConstants
+{
+	Matrix Orientation;
+	Float3 Position;
+
+	uint32 FrameIndex;
+
+	uint32 MaxDepth;
+	uint32 SamplesPerPixel;
+
+	uint32 AccumulationTextureIndex;
+	uint32 VarianceTextureIndex;
+
+	float NoiseThreshold;
+
+	uint32 SpheresBufferIndex;
+	uint32 SpheresBufferCount;
+
+	uint32 BvhNodesBufferIndex;
+
+	PAD(152);
+};
+
+struct ResolveRootConstants
+{
+	uint32 AccumulationTextureIndex;
+	uint32 OutputTextureIndex;
+};
+
+}